@@ -4,9 +4,14 @@
 #include <QMenu>
 #include <QAction>
 #include <QFileDialog>
-#include <QTreeWidget>
+#include <QTreeView>
+#include <QAbstractItemModel>
 #include <QTabWidget>
 #include <QTextEdit>
+#include <QPlainTextEdit>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QElapsedTimer>
 #include <QSplitter>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -37,6 +42,7 @@
 #include <QButtonGroup>
 #include <QGroupBox>
 #include <QCheckBox>
+#include <QFormLayout>
 #include <QLineEdit>
 #include <QProgressDialog>
 #include <QCompleter>
@@ -46,233 +52,4927 @@
 #include <QScrollBar>
 #include <QClipboard>
 #include <QMimeData>
+#include <QStringDecoder>
+#include <QByteArrayView>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QMap>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QThread>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QSet>
+#include <QHash>
+#include <QFileSystemWatcher>
+#include <QDateTime>
+#include <QLocale>
+#include <QTimeZone>
+#include <QRandomGenerator>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QEventLoop>
+#include <QWaitCondition>
+#include <QDirIterator>
+#include <QProgressBar>
+#include <QSocketNotifier>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <sys/inotify.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
+
+// Persistent rope holding the editor text. Nodes are immutable and shared,
+// so copying a TextRope is an O(1) snapshot that worker threads can read
+// while the editor keeps changing its own copy. Inserts and removals go
+// through split/join on an AVL-balanced tree and rebuild only the O(log n)
+// nodes along the edit path. Every node also counts newlines, which gives
+// line <-> offset lookups without scanning the text.
+class TextRope {
+public:
+    TextRope() = default;
+
+    explicit TextRope(const QString &text) {
+        root = build(text, 0, text.size());
+    }
+
+    int length() const {
+        return lengthOf(root);
+    }
+
+    int lineCount() const {
+        return newlinesOf(root) + 1;
+    }
+
+    void insert(int pos, const QString &text) {
+        if (text.isEmpty()) {
+            return;
+        }
+        NodePair parts = split(root, qBound(0, pos, length()));
+        root = join(join(parts.first, build(text, 0, text.size())), parts.second);
+    }
+
+    void remove(int pos, int count) {
+        pos = qBound(0, pos, length());
+        count = qBound(0, count, length() - pos);
+        if (count == 0) {
+            return;
+        }
+        NodePair head = split(root, pos);
+        NodePair tail = split(head.second, count);
+        root = join(head.first, tail.second);
+    }
+
+    // Visits the text in order, one leaf at a time
+    void forEachChunk(const std::function<void(QStringView)> &visit) const {
+        forEachChunk(root, visit);
+    }
+
+    QString toString() const {
+        QString text;
+        text.reserve(length());
+        forEachChunk([&text](QStringView chunk) { text += chunk; });
+        return text;
+    }
+
+    // Hash of the UTF-16 text; independent of how it is split into leaves.
+    // Used to tell whether a buffer differs from what is on disk, not for
+    // anything security related.
+    QByteArray contentHash() const {
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        forEachChunk([&hash](QStringView chunk) {
+            hash.addData(QByteArrayView(reinterpret_cast<const char *>(chunk.utf16()), chunk.size() * 2));
+        });
+        return hash.result();
+    }
+
+    QString mid(int pos, int count) const {
+        QString text;
+        collect(root, qMax(0, pos), qMax(0, count), text);
+        return text;
+    }
+
+    int indexOf(const QString &needle, int from = 0) const {
+        // Scan leaf by leaf, carrying the last needle.size() - 1 chars so
+        // matches that straddle two leaves are found too.
+        QString window;
+        int windowStart = 0;
+        int offset = 0;
+        int found = -1;
+        forEachChunk([&](QStringView chunk) {
+            if (found >= 0) {
+                return;
+            }
+            window += chunk;
+            int index = window.indexOf(needle, qMax(0, from - windowStart));
+            if (index >= 0) {
+                found = windowStart + index;
+                return;
+            }
+            offset += chunk.size();
+            int keep = qMin(int(window.size()), int(needle.size()) - 1);
+            window = window.right(keep);
+            windowStart = offset - keep;
+        });
+        return found;
+    }
+
+    // Offset of the first character of a 0-based line
+    int lineStart(int line) const {
+        int offset = 0;
+        NodePtr node = root;
+        while (node && line > 0) {
+            if (!node->left) {
+                int index = -1;
+                for (int i = 0; i < line; ++i) {
+                    index = node->leaf.indexOf(QLatin1Char('\n'), index + 1);
+                    if (index < 0) {
+                        return offset + node->length;
+                    }
+                }
+                return offset + index + 1;
+            }
+            if (line <= node->left->newlines) {
+                node = node->left;
+            } else {
+                line -= node->left->newlines;
+                offset += node->left->length;
+                node = node->right;
+            }
+        }
+        return offset;
+    }
+
+    // 0-based line containing offset
+    int lineAt(int offset) const {
+        int line = 0;
+        NodePtr node = root;
+        while (node) {
+            if (!node->left) {
+                return line + int(QStringView(node->leaf).left(qBound(0, offset, node->length)).count(QLatin1Char('\n')));
+            }
+            if (offset < node->left->length) {
+                node = node->left;
+            } else {
+                line += node->left->newlines;
+                offset -= node->left->length;
+                node = node->right;
+            }
+        }
+        return line;
+    }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+    using NodePair = QPair<NodePtr, NodePtr>;
+
+    // A leaf holds text; an inner node always has two children
+    struct Node {
+        NodePtr left;
+        NodePtr right;
+        QString leaf;
+        int length = 0;
+        int newlines = 0;
+        int height = 0;
+    };
+
+    static const int LeafSize = 1024;
+
+    static int lengthOf(const NodePtr &node) { return node ? node->length : 0; }
+    static int newlinesOf(const NodePtr &node) { return node ? node->newlines : 0; }
+    static int heightOf(const NodePtr &node) { return node ? node->height : -1; }
+
+    static NodePtr makeLeaf(const QString &text) {
+        if (text.isEmpty()) {
+            return NodePtr();
+        }
+        auto node = std::make_shared<Node>();
+        node->leaf = text;
+        node->length = text.size();
+        node->newlines = int(text.count(QLatin1Char('\n')));
+        return node;
+    }
+
+    static NodePtr makeInner(const NodePtr &left, const NodePtr &right) {
+        auto node = std::make_shared<Node>();
+        node->left = left;
+        node->right = right;
+        node->length = left->length + right->length;
+        node->newlines = left->newlines + right->newlines;
+        node->height = qMax(left->height, right->height) + 1;
+        return node;
+    }
+
+    static NodePtr build(const QString &text, int from, int to) {
+        if (to - from <= LeafSize) {
+            return makeLeaf(text.mid(from, to - from));
+        }
+        int middle = from + (to - from) / 2;
+        return makeInner(build(text, from, middle), build(text, middle, to));
+    }
+
+    static NodePtr rotateLeft(const NodePtr &node) {
+        return makeInner(makeInner(node->left, node->right->left), node->right->right);
+    }
+
+    static NodePtr rotateRight(const NodePtr &node) {
+        return makeInner(node->left->left, makeInner(node->left->right, node->right));
+    }
+
+    static NodePtr balance(const NodePtr &left, const NodePtr &right) {
+        NodePtr node = makeInner(left, right);
+        if (heightOf(left) > heightOf(right) + 1) {
+            if (heightOf(left->left) < heightOf(left->right)) {
+                node = makeInner(rotateLeft(left), right);
+            }
+            return rotateRight(node);
+        }
+        if (heightOf(right) > heightOf(left) + 1) {
+            if (heightOf(right->right) < heightOf(right->left)) {
+                node = makeInner(left, rotateRight(right));
+            }
+            return rotateLeft(node);
+        }
+        return node;
+    }
+
+    static NodePtr join(const NodePtr &left, const NodePtr &right) {
+        if (!left) return right;
+        if (!right) return left;
+        if (!left->left && !right->left && left->length + right->length <= LeafSize) {
+            // Keep typing from producing a leaf per keystroke
+            return makeLeaf(left->leaf + right->leaf);
+        }
+        if (left->height > right->height + 1) {
+            return balance(left->left, join(left->right, right));
+        }
+        if (right->height > left->height + 1) {
+            return balance(join(left, right->left), right->right);
+        }
+        return makeInner(left, right);
+    }
+
+    static NodePair split(const NodePtr &node, int pos) {
+        if (!node) {
+            return NodePair();
+        }
+        if (!node->left) {
+            return NodePair(makeLeaf(node->leaf.left(pos)), makeLeaf(node->leaf.mid(pos)));
+        }
+        const int leftLength = node->left->length;
+        if (pos < leftLength) {
+            NodePair parts = split(node->left, pos);
+            return NodePair(parts.first, join(parts.second, node->right));
+        }
+        if (pos > leftLength) {
+            NodePair parts = split(node->right, pos - leftLength);
+            return NodePair(join(node->left, parts.first), parts.second);
+        }
+        return NodePair(node->left, node->right);
+    }
+
+    static void forEachChunk(const NodePtr &node, const std::function<void(QStringView)> &visit) {
+        if (!node) {
+            return;
+        }
+        if (!node->left) {
+            visit(node->leaf);
+            return;
+        }
+        forEachChunk(node->left, visit);
+        forEachChunk(node->right, visit);
+    }
+
+    static void collect(const NodePtr &node, int pos, int count, QString &out) {
+        if (!node || count <= 0 || pos >= node->length) {
+            return;
+        }
+        if (!node->left) {
+            out += QStringView(node->leaf).mid(pos, count);
+            return;
+        }
+        const int leftLength = node->left->length;
+        if (pos < leftLength) {
+            collect(node->left, pos, count, out);
+        }
+        int rightPos = qMax(0, pos - leftLength);
+        int rightCount = count - qMax(0, leftLength - pos);
+        collect(node->right, rightPos, rightCount, out);
+    }
+
+    NodePtr root;
+};
+
+// Keyword lookup used by the lexer. Words are bucketed by (length, first
+// letter), so nearly every bucket holds one candidate and a lookup costs a
+// single short compare instead of a regex pass per keyword.
+class KeywordTable {
+public:
+    KeywordTable(std::initializer_list<const char *> words, Qt::CaseSensitivity cs = Qt::CaseSensitive)
+        : sensitivity(cs) {
+        for (const char *word : words) {
+            QLatin1String keyword(word);
+            if (keyword.size() < MaxLength) {
+                buckets[keyword.size()][keyword.at(0).toLatin1() - 'a'].append(keyword);
+            }
+        }
+    }
+
+    bool contains(QStringView word) const {
+        if (word.isEmpty() || word.size() >= MaxLength) {
+            return false;
+        }
+        ushort first = sensitivity == Qt::CaseInsensitive ? word.front().toLower().unicode() : word.front().unicode();
+        if (first < 'a' || first > 'z') {
+            return false;
+        }
+        for (const QLatin1String &candidate : buckets[word.size()][first - 'a']) {
+            if (word.compare(candidate, sensitivity) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static const int MaxLength = 16;
+    QVector<QLatin1String> buckets[MaxLength][26];
+    Qt::CaseSensitivity sensitivity;
+};
+
+// Single-pass tokenizer for HTML/CSS/JS/PHP. Each line is scanned once,
+// left to right; the returned state carries the active language and any
+// construct still open at the end of the line (comment, template literal,
+// tag, embedded region) into the next line. QSyntaxHighlighter stops at the
+// first block whose end state is unchanged, so an edit costs O(changed lines).
+class CodeLexer {
+public:
+    enum Language { Html = 0, Css = 1, Js = 2, Php = 3 };
+    enum TokenKind { Tag, Attribute, String, Keyword, CssProperty, PhpTag, Number, Comment, TokenKindCount };
+
+    struct Token {
+        int start;
+        int length;
+        TokenKind kind;
+    };
+
+    // State layout (an int, as stored by QSyntaxHighlighter per block):
+    //   bits 0-1   active language
+    //   bit  2     language was entered from an HTML <script>/<style> element
+    //   bits 3-5   construct still open at the end of the line (Inner)
+    //   bits 6-7   kind of tag being scanned while Inner is a tag state
+    //   bits 8-10  language + embedded flag to return to after ?>
+    enum StateBits { LanguageMask = 0x3, EmbeddedFlag = 0x4, ContextMask = 0x7, InnerBits = 0xF8, PhpReturnShift = 8 };
+    enum Inner { NoInner, BlockComment, HtmlComment, TemplateLiteral, InTag, DoubleQuoted, SingleQuoted };
+    enum TagKind { PlainTag, ScriptTag, StyleTag };
+
+    static Language languageForFileType(const QString &type) {
+        if (type == "css") return Css;
+        if (type == "js" || type == "mjs" || type == "cjs" || type == "json") return Js;
+        return Html; // HTML, PHP (starts outside <?php) and anything else
+    }
+
+    static int initialState(Language language) {
+        return language;
+    }
+
+    static int lexLine(QStringView text, int state, QVector<Token> &tokens) {
+        int pos = innerOf(state) != NoInner ? resume(text, state, tokens) : 0;
+        while (pos < text.size()) {
+            switch (state & LanguageMask) {
+            case Html: pos = lexHtml(text, pos, state, tokens); break;
+            case Css: pos = lexCss(text, pos, state, tokens); break;
+            case Js: pos = lexScript(text, pos, state, tokens); break;
+            case Php: pos = lexPhp(text, pos, state, tokens); break;
+            }
+        }
+        return state;
+    }
+
+private:
+    static const KeywordTable &jsKeywords() {
+        static const KeywordTable table({
+            "function", "var", "let", "const", "return", "if", "else", "for",
+            "while", "do", "switch", "case", "default", "break", "continue",
+            "true", "false", "null", "undefined", "new", "this", "class",
+            "extends", "super", "typeof", "instanceof", "in", "of", "delete",
+            "void", "try", "catch", "finally", "throw", "async", "await",
+            "yield", "import", "export", "static"
+        });
+        return table;
+    }
+
+    static const KeywordTable &phpKeywords() {
+        static const KeywordTable table({
+            "function", "fn", "return", "if", "else", "elseif", "for", "foreach",
+            "as", "while", "do", "switch", "case", "default", "break", "continue",
+            "echo", "print", "true", "false", "null", "new", "class", "extends",
+            "implements", "interface", "public", "private", "protected", "static",
+            "const", "array", "isset", "empty", "unset", "require", "require_once",
+            "include", "include_once", "namespace", "use", "try", "catch",
+            "finally", "throw", "match"
+        }, Qt::CaseInsensitive);
+        return table;
+    }
+
+    static Inner innerOf(int state) {
+        return Inner((state >> 3) & 0x7);
+    }
+
+    static TagKind tagOf(int state) {
+        return TagKind((state >> 6) & 0x3);
+    }
+
+    static int withInner(int state, Inner inner, TagKind tag = PlainTag) {
+        return (state & ~InnerBits) | (inner << 3) | (tag << 6);
+    }
+
+    static bool isIdentStart(QChar c) {
+        return c.isLetter() || c == QLatin1Char('_') || c == QLatin1Char('$');
+    }
+
+    static bool isIdentChar(QChar c) {
+        return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('$');
+    }
+
+    static bool startsWithAt(QStringView text, int pos, QStringView what, Qt::CaseSensitivity cs = Qt::CaseSensitive) {
+        return text.mid(pos).startsWith(what, cs);
+    }
+
+    // Picks up a construct left open by the previous line.
+    static int resume(QStringView text, int &state, QVector<Token> &tokens) {
+        const Inner inner = innerOf(state);
+        const TagKind tag = tagOf(state);
+        switch (inner) {
+        case BlockComment:
+            return lexDelimited(text, 0, 0, u"*/", BlockComment, state, tokens);
+        case HtmlComment:
+            return lexDelimited(text, 0, 0, u"-->", HtmlComment, state, tokens);
+        case TemplateLiteral:
+            return lexQuoted(text, 0, 0, QLatin1Char('`'), state, tokens);
+        case DoubleQuoted:
+        case SingleQuoted: {
+            int pos = lexQuoted(text, 0, 0, QLatin1Char(inner == DoubleQuoted ? '"' : '\''), state, tokens);
+            if ((state & LanguageMask) == Html && innerOf(state) == NoInner) {
+                // Attribute value spanning lines: carry on with the tag
+                return lexTagBody(text, pos, tag, state, tokens);
+            }
+            return pos;
+        }
+        case InTag:
+            return lexTagBody(text, 0, tag, state, tokens);
+        default:
+            return 0;
+        }
+    }
+
+    // Scans to terminator as a comment; if the line ends first the
+    // construct stays open in state.
+    static int lexDelimited(QStringView text, int start, int from, QStringView terminator, Inner inner, int &state, QVector<Token> &tokens) {
+        int end = text.indexOf(terminator, from);
+        if (end < 0) {
+            end = text.size();
+            state = withInner(state, inner);
+        } else {
+            end += terminator.size();
+            state = withInner(state, NoInner);
+        }
+        tokens.append({start, end - start, Comment});
+        return end;
+    }
+
+    // Scans a quoted run whose body starts at from. Template literals, PHP
+    // strings and attribute values may span lines; JS/CSS strings only do so
+    // with a trailing backslash.
+    static int lexQuoted(QStringView text, int start, int from, QChar quote, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        int end = from;
+        bool escapedNewline = false;
+        while (end < len && text[end] != quote) {
+            if (text[end] == QLatin1Char('\\')) {
+                escapedNewline = end + 1 == len;
+                end += 2;
+            } else {
+                ++end;
+            }
+        }
+        if (end < len) {
+            ++end;
+            state = withInner(state, NoInner);
+        } else {
+            end = len;
+            const int language = state & LanguageMask;
+            if (quote == QLatin1Char('`')) {
+                state = withInner(state, TemplateLiteral);
+            } else if (language == Html || language == Php || escapedNewline) {
+                state = withInner(state, quote == QLatin1Char('"') ? DoubleQuoted : SingleQuoted, tagOf(state));
+            } else {
+                state = withInner(state, NoInner);
+            }
+        }
+        tokens.append({start, end - start, String});
+        return end;
+    }
+
+    static int lexString(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        return lexQuoted(text, pos, pos + 1, text[pos], state, tokens);
+    }
+
+    static int lexNumber(QStringView text, int pos, QVector<Token> &tokens) {
+        int end = pos;
+        while (end < text.size() && (text[end].isDigit() || text[end] == QLatin1Char('.'))) {
+            ++end;
+        }
+        tokens.append({pos, end - pos, Number});
+        return end;
+    }
+
+    static int lexBlockComment(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        return lexDelimited(text, pos, pos + 2, u"*/", BlockComment, state, tokens);
+    }
+
+    static int lexLineComment(QStringView text, int pos, QVector<Token> &tokens) {
+        tokens.append({pos, int(text.size()) - pos, Comment});
+        return int(text.size());
+    }
+
+    static bool isPhpOpen(QStringView text, int pos) {
+        return startsWithAt(text, pos, u"<?php", Qt::CaseInsensitive) || startsWithAt(text, pos, u"<?=");
+    }
+
+    // Enters PHP, remembering the surrounding language for the closing ?>
+    static int lexPhpOpen(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        int length = startsWithAt(text, pos, u"<?=") ? 3 : 5;
+        tokens.append({pos, length, PhpTag});
+        state = Php | ((state & ContextMask) << PhpReturnShift);
+        return pos + length;
+    }
+
+    static int lexHtml(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        while (pos < len) {
+            int lt = text.indexOf(QLatin1Char('<'), pos);
+            if (lt < 0) {
+                return len;
+            }
+            if (startsWithAt(text, lt, u"<!--")) {
+                pos = lexDelimited(text, lt, lt + 4, u"-->", HtmlComment, state, tokens);
+            } else if (isPhpOpen(text, lt)) {
+                return lexPhpOpen(text, lt, state, tokens);
+            } else if (lt + 1 < len && (text[lt + 1].isLetter() || text[lt + 1] == QLatin1Char('/'))) {
+                pos = lexTag(text, lt, state, tokens);
+                if ((state & LanguageMask) != Html) {
+                    return pos;
+                }
+            } else {
+                pos = lt + 1;
+            }
+        }
+        return pos;
+    }
+
+    static int lexTag(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        const int start = pos++;
+        const bool closing = text[pos] == QLatin1Char('/');
+        if (closing) {
+            ++pos;
+        }
+        const int nameStart = pos;
+        while (pos < len && (text[pos].isLetterOrNumber() || text[pos] == QLatin1Char('-'))) {
+            ++pos;
+        }
+        const QStringView name = text.mid(nameStart, pos - nameStart);
+        tokens.append({start, pos - start, Tag});
+
+        TagKind tag = PlainTag;
+        if (!closing && name.compare(u"script", Qt::CaseInsensitive) == 0) {
+            tag = ScriptTag;
+        } else if (!closing && name.compare(u"style", Qt::CaseInsensitive) == 0) {
+            tag = StyleTag;
+        }
+        return lexTagBody(text, pos, tag, state, tokens);
+    }
+
+    // Attributes up to the closing '>'. A tag that runs past the end of the
+    // line leaves InTag in state; closing an opening <script>/<style> tag
+    // switches into the embedded language.
+    static int lexTagBody(QStringView text, int pos, TagKind tag, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        while (pos < len) {
+            const QChar c = text[pos];
+            if (c == QLatin1Char('>') || (c == QLatin1Char('/') && pos + 1 < len && text[pos + 1] == QLatin1Char('>'))) {
+                const int length = c == QLatin1Char('>') ? 1 : 2;
+                tokens.append({pos, length, Tag});
+                if (tag == ScriptTag && length == 1) {
+                    state = Js | EmbeddedFlag;
+                } else if (tag == StyleTag && length == 1) {
+                    state = Css | EmbeddedFlag;
+                } else {
+                    state = withInner(state, NoInner);
+                }
+                return pos + length;
+            }
+            if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+                state = withInner(state, NoInner, tag);
+                pos = lexString(text, pos, state, tokens);
+                if (innerOf(state) != NoInner) {
+                    return pos;
+                }
+            } else if (c.isLetter() || c == QLatin1Char('-')) {
+                int end = pos;
+                while (end < len && (text[end].isLetter() || text[end] == QLatin1Char('-'))) {
+                    ++end;
+                }
+                if (end < len && text[end] == QLatin1Char('=')) {
+                    tokens.append({pos, end - pos, Attribute});
+                }
+                pos = end;
+            } else {
+                ++pos;
+            }
+        }
+        state = withInner(state, InTag, tag);
+        return pos;
+    }
+
+    // Returns true when an embedded <script>/<style> body ends at pos; the
+    // closing tag itself is left for the HTML lexer.
+    static bool leavesEmbedded(QStringView text, int pos, int &state, QStringView closeTag) {
+        if ((state & EmbeddedFlag) && startsWithAt(text, pos, closeTag, Qt::CaseInsensitive)) {
+            state = Html;
+            return true;
+        }
+        return false;
+    }
+
+    static int lexCss(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        while (pos < len) {
+            const QChar c = text[pos];
+            if (c == QLatin1Char('<')) {
+                if (leavesEmbedded(text, pos, state, u"</style")) {
+                    return pos;
+                }
+                if (isPhpOpen(text, pos)) {
+                    return lexPhpOpen(text, pos, state, tokens);
+                }
+                ++pos;
+            } else if (c == QLatin1Char('/') && pos + 1 < len && text[pos + 1] == QLatin1Char('*')) {
+                pos = lexBlockComment(text, pos, state, tokens);
+            } else if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+                pos = lexString(text, pos, state, tokens);
+            } else if (c.isDigit()) {
+                pos = lexNumber(text, pos, tokens);
+            } else if (c.isLetter() || c == QLatin1Char('-')) {
+                int end = pos;
+                while (end < len && (text[end].isLetterOrNumber() || text[end] == QLatin1Char('-'))) {
+                    ++end;
+                }
+                int colon = end;
+                while (colon < len && text[colon].isSpace()) {
+                    ++colon;
+                }
+                if (colon < len && text[colon] == QLatin1Char(':')) {
+                    tokens.append({pos, end - pos, CssProperty});
+                }
+                pos = end;
+            } else {
+                ++pos;
+            }
+        }
+        return pos;
+    }
+
+    static int lexScript(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        while (pos < len) {
+            const QChar c = text[pos];
+            const QChar next = pos + 1 < len ? text[pos + 1] : QChar();
+            if (c == QLatin1Char('<')) {
+                if (leavesEmbedded(text, pos, state, u"</script")) {
+                    return pos;
+                }
+                if (isPhpOpen(text, pos)) {
+                    return lexPhpOpen(text, pos, state, tokens);
+                }
+                ++pos;
+            } else if (c == QLatin1Char('/') && next == QLatin1Char('/')) {
+                pos = lexLineComment(text, pos, tokens);
+            } else if (c == QLatin1Char('/') && next == QLatin1Char('*')) {
+                pos = lexBlockComment(text, pos, state, tokens);
+            } else if (c == QLatin1Char('"') || c == QLatin1Char('\'') || c == QLatin1Char('`')) {
+                pos = lexString(text, pos, state, tokens);
+            } else if (c.isDigit()) {
+                pos = lexNumber(text, pos, tokens);
+            } else if (isIdentStart(c)) {
+                int end = pos;
+                while (end < len && isIdentChar(text[end])) {
+                    ++end;
+                }
+                if (jsKeywords().contains(text.mid(pos, end - pos))) {
+                    tokens.append({pos, end - pos, Keyword});
+                }
+                pos = end;
+            } else {
+                ++pos;
+            }
+        }
+        return pos;
+    }
+
+    static int lexPhp(QStringView text, int pos, int &state, QVector<Token> &tokens) {
+        const int len = text.size();
+        while (pos < len) {
+            const QChar c = text[pos];
+            const QChar next = pos + 1 < len ? text[pos + 1] : QChar();
+            if (c == QLatin1Char('?') && next == QLatin1Char('>')) {
+                tokens.append({pos, 2, PhpTag});
+                state = (state >> PhpReturnShift) & ContextMask;
+                return pos + 2;
+            } else if (c == QLatin1Char('#') || (c == QLatin1Char('/') && next == QLatin1Char('/'))) {
+                // Line comments stop at a closing ?> on the same line
+                int end = text.indexOf(u"?>", pos);
+                end = end < 0 ? len : end;
+                tokens.append({pos, end - pos, Comment});
+                pos = end;
+            } else if (c == QLatin1Char('/') && next == QLatin1Char('*')) {
+                pos = lexBlockComment(text, pos, state, tokens);
+            } else if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+                pos = lexString(text, pos, state, tokens);
+            } else if (c.isDigit()) {
+                pos = lexNumber(text, pos, tokens);
+            } else if (isIdentStart(c)) {
+                int end = pos + 1;
+                while (end < len && isIdentChar(text[end])) {
+                    ++end;
+                }
+                if (c != QLatin1Char('$') && phpKeywords().contains(text.mid(pos, end - pos))) {
+                    tokens.append({pos, end - pos, Keyword});
+                }
+                pos = end;
+            } else {
+                ++pos;
+            }
+        }
+        return pos;
+    }
+};
+
+// Syntax Highlighter for HTML/CSS/JS/PHP
+class CodeHighlighter : public QSyntaxHighlighter {
+public:
+    CodeHighlighter(QTextDocument *parent = nullptr, CodeLexer::Language lang = CodeLexer::Html)
+        : QSyntaxHighlighter(parent), language(lang) {
+    }
+
+    void setLanguage(CodeLexer::Language lang) {
+        if (lang != language) {
+            language = lang;
+            rehighlight();
+        }
+    }
+
+    static const QTextCharFormat &formatFor(CodeLexer::TokenKind kind) {
+        static const QVector<QTextCharFormat> formats = []() {
+            QVector<QTextCharFormat> f(CodeLexer::TokenKindCount);
+            f[CodeLexer::Tag].setForeground(QColor(86, 156, 214));
+            f[CodeLexer::Tag].setFontWeight(QFont::Bold);
+
+            f[CodeLexer::Attribute].setForeground(QColor(156, 220, 254));
+
+            f[CodeLexer::String].setForeground(QColor(206, 145, 120));
+
+            f[CodeLexer::Keyword].setForeground(QColor(197, 134, 192));
+            f[CodeLexer::Keyword].setFontWeight(QFont::Bold);
+
+            f[CodeLexer::CssProperty].setForeground(QColor(156, 220, 254));
+
+            f[CodeLexer::PhpTag].setForeground(QColor(197, 134, 192));
+            f[CodeLexer::PhpTag].setFontWeight(QFont::Bold);
+
+            f[CodeLexer::Number].setForeground(QColor(181, 206, 168));
+
+            f[CodeLexer::Comment].setForeground(QColor(106, 153, 85));
+            f[CodeLexer::Comment].setFontItalic(true);
+            return f;
+        }();
+        return formats[kind];
+    }
+
+protected:
+    void highlightBlock(const QString &text) override {
+        int state = previousBlockState();
+        if (state < 0) {
+            state = CodeLexer::initialState(language);
+        }
+
+        tokens.clear();
+        state = CodeLexer::lexLine(text, state, tokens);
+        for (const CodeLexer::Token &token : tokens) {
+            setFormat(token.start, token.length, formatFor(token.kind));
+        }
+
+        // Unchanged end state lets QSyntaxHighlighter stop after this block
+        setCurrentBlockState(state);
+    }
+
+private:
+    CodeLexer::Language language;
+    QVector<CodeLexer::Token> tokens;
+};
+
+// Lexer output for a run of consecutive lines, produced on a worker thread
+struct HighlightBatch {
+    int generation;
+    int firstLine;
+    bool finished;
+    QVector<int> states;
+    QVector<QVector<CodeLexer::Token>> tokens;
+};
+
+// Shared between a BackgroundHighlighter and the tasks it starts. Bumping
+// generation cancels a running pass; receiver is cleared under the mutex
+// when the highlighter goes away so a task never posts to a dead object.
+struct HighlightChannel {
+    QMutex mutex;
+    QObject *receiver = nullptr;
+    std::function<void(const HighlightBatch &)> deliver;
+    QAtomicInt generation;
+};
+
+// Lexes an immutable text snapshot off the GUI thread. The visible lines
+// are delivered first, then everything else in batches.
+class HighlightTask : public QRunnable {
+public:
+    HighlightTask(std::shared_ptr<HighlightChannel> channel, int generation, const TextRope &snapshot,
+                  int startLine, int startState, int visibleFirst, int visibleLast)
+        : channel(channel), generation(generation), snapshot(snapshot), startLine(startLine),
+          startState(startState), visibleFirst(visibleFirst), visibleLast(visibleLast) {
+    }
+
+    void run() override {
+        // Materialize only the lines to lex, here rather than on the GUI thread
+        const int offset = snapshot.lineStart(startLine);
+        text = snapshot.mid(offset, snapshot.length() - offset);
+
+        QVector<int> lineStarts;
+        int pos = 0;
+        while (pos <= text.size()) {
+            lineStarts.append(pos);
+            int nl = text.indexOf(QLatin1Char('\n'), pos);
+            pos = nl < 0 ? text.size() + 1 : nl + 1;
+        }
+
+        const int count = lineStarts.size();
+        QVector<int> states(count, -1);
+        const int first = qBound(0, visibleFirst - startLine, count);
+        const int last = qBound(-1, visibleLast - startLine, count - 1);
+
+        // Lex up to the end of the viewport, keeping tokens only for the
+        // visible lines, and hand those over first.
+        HighlightBatch visible = newBatch(first);
+        QVector<CodeLexer::Token> tokens;
+        for (int i = 0; i <= last; ++i) {
+            if (i % 256 == 0 && cancelled()) {
+                return;
+            }
+            tokens.clear();
+            states[i] = CodeLexer::lexLine(lineAt(lineStarts, i), stateBefore(states, i), tokens);
+            if (i >= first) {
+                visible.states.append(states[i]);
+                visible.tokens.append(tokens);
+            }
+        }
+        if (!visible.states.isEmpty() && !post(visible)) {
+            return;
+        }
+
+        // Then fill in the lines above and below the viewport
+        if (!emitRange(lineStarts, states, 0, first) || !emitRange(lineStarts, states, last + 1, count)) {
+            return;
+        }
+        HighlightBatch done = newBatch(count);
+        done.finished = true;
+        post(done);
+    }
+
+private:
+    static const int BatchLines = 1000;
+
+    QStringView lineAt(const QVector<int> &lineStarts, int i) const {
+        int end = i + 1 < lineStarts.size() ? lineStarts[i + 1] - 1 : text.size();
+        return QStringView(text).mid(lineStarts[i], end - lineStarts[i]);
+    }
+
+    int stateBefore(const QVector<int> &states, int i) const {
+        return i == 0 ? startState : states[i - 1];
+    }
+
+    HighlightBatch newBatch(int firstLine) const {
+        HighlightBatch batch;
+        batch.generation = generation;
+        batch.firstLine = startLine + firstLine;
+        batch.finished = false;
+        return batch;
+    }
+
+    bool emitRange(const QVector<int> &lineStarts, QVector<int> &states, int from, int to) {
+        for (int begin = from; begin < to; begin += BatchLines) {
+            if (cancelled()) {
+                return false;
+            }
+            HighlightBatch batch = newBatch(begin);
+            int end = qMin(to, begin + BatchLines);
+            QVector<CodeLexer::Token> tokens;
+            for (int i = begin; i < end; ++i) {
+                tokens.clear();
+                states[i] = CodeLexer::lexLine(lineAt(lineStarts, i), stateBefore(states, i), tokens);
+                batch.states.append(states[i]);
+                batch.tokens.append(tokens);
+            }
+            if (!post(batch)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool cancelled() const {
+        return channel->generation.loadAcquire() != generation;
+    }
+
+    bool post(const HighlightBatch &batch) {
+        QMutexLocker locker(&channel->mutex);
+        if (!channel->receiver || cancelled()) {
+            return false;
+        }
+        std::shared_ptr<HighlightChannel> ch = channel;
+        QMetaObject::invokeMethod(channel->receiver, [ch, batch]() {
+            ch->deliver(batch);
+        }, Qt::QueuedConnection);
+        return true;
+    }
+
+    std::shared_ptr<HighlightChannel> channel;
+    int generation;
+    TextRope snapshot;
+    QString text;
+    int startLine;
+    int startState;
+    int visibleFirst;
+    int visibleLast;
+};
+
+// Highlighter for large documents. Formats are computed by HighlightTask on
+// the global thread pool and applied to the block layouts as they arrive;
+// the per-block end state lives in QTextBlock::userState like it does for
+// QSyntaxHighlighter. Small edits are re-lexed synchronously until the
+// state converges, anything larger goes back to the worker.
+class BackgroundHighlighter : public QObject {
+    Q_OBJECT
+
+public:
+    BackgroundHighlighter(QTextDocument *doc, CodeLexer::Language lang, std::function<TextRope()> snapshot,
+                          std::function<QPair<int, int>()> visibleRange)
+        : QObject(doc), document(doc), language(lang), snapshot(snapshot), visibleRange(visibleRange),
+          channel(std::make_shared<HighlightChannel>()) {
+        channel->receiver = this;
+        channel->deliver = [this](const HighlightBatch &batch) { applyBatch(batch); };
+
+        restartTimer.setSingleShot(true);
+        restartTimer.setInterval(200);
+        connect(&restartTimer, &QTimer::timeout, this, &BackgroundHighlighter::resumePass);
+        connect(document, &QTextDocument::contentsChange, this, &BackgroundHighlighter::onContentsChange);
+
+        startPass(0, CodeLexer::initialState(language));
+    }
+
+    ~BackgroundHighlighter() {
+        QMutexLocker locker(&channel->mutex);
+        channel->receiver = nullptr;
+        channel->generation.fetchAndAddOrdered(1);
+    }
+
+    void setLanguage(CodeLexer::Language lang) {
+        if (lang != language) {
+            language = lang;
+            startPass(0, CodeLexer::initialState(language));
+        }
+    }
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded) {
+        Q_UNUSED(charsRemoved);
+        QTextBlock block = document->findBlock(position);
+        QTextBlock previous = block.previous();
+        int state = previous.isValid() ? previous.userState() : CodeLexer::initialState(language);
+
+        if (passRunning || state < 0) {
+            // The running pass may not have reached this far yet; its results
+            // are stale now, so resume once typing settles from the edit or
+            // from the first line it had not delivered, whichever is earlier.
+            channel->generation.fetchAndAddOrdered(1);
+            const int line = passRunning ? qMin(block.blockNumber(), validLines) : block.blockNumber();
+            restartLine = restartLine < 0 ? line : qMin(restartLine, line);
+            if (state >= 0) {
+                relex(block, state, position + charsAdded);
+            }
+            restartTimer.start();
+            return;
+        }
+
+        QTextBlock next = relex(block, state, position + charsAdded);
+        if (next.isValid()) {
+            startPass(next.blockNumber(), next.previous().userState());
+        }
+    }
+
+private:
+    static const int SyncBlockLimit = 200;
+
+    // Re-lexes from block until the end state matches what was stored
+    // before the edit. Returns the block to continue from on the worker
+    // if the sync budget ran out first.
+    QTextBlock relex(QTextBlock block, int state, int editEnd) {
+        QVector<CodeLexer::Token> tokens;
+        const int from = block.position();
+        int lexed = 0;
+        while (block.isValid()) {
+            if (lexed++ == SyncBlockLimit) {
+                markDirty(from, block.position());
+                return block;
+            }
+            tokens.clear();
+            const int oldState = block.userState();
+            state = CodeLexer::lexLine(block.text(), state, tokens);
+            applyTokens(block, tokens);
+            block.setUserState(state);
+            const bool pastEdit = block.position() + block.length() > editEnd;
+            block = block.next();
+            if (pastEdit && oldState == state) {
+                break;
+            }
+        }
+        markDirty(from, block.isValid() ? block.position() : document->characterCount());
+        return QTextBlock();
+    }
+
+    // Lines before restartLine kept their states, so the next pass is
+    // seeded from the last of them
+    void resumePass() {
+        QTextBlock block = document->findBlockByNumber(qMax(restartLine, 0));
+        if (!block.isValid()) {
+            block = document->lastBlock();
+        }
+        const QTextBlock previous = block.previous();
+        const int state = previous.isValid() ? previous.userState() : CodeLexer::initialState(language);
+        if (state < 0) {
+            startPass(0, CodeLexer::initialState(language));
+        } else {
+            startPass(block.blockNumber(), state);
+        }
+    }
+
+    void startPass(int startLine, int startState) {
+        restartTimer.stop();
+        const int generation = channel->generation.fetchAndAddOrdered(1) + 1;
+        const QPair<int, int> visible = visibleRange();
+        passRunning = true;
+        restartLine = -1;
+        validLines = startLine;
+        delivered.clear();
+        QThreadPool::globalInstance()->start(new HighlightTask(channel, generation, snapshot(),
+                                                               startLine, startState, visible.first, visible.second));
+    }
+
+    void applyBatch(const HighlightBatch &batch) {
+        if (batch.generation != channel->generation.loadAcquire()) {
+            return;
+        }
+        if (batch.finished) {
+            passRunning = false;
+            delivered.clear();
+            return;
+        }
+        QTextBlock block = document->findBlockByNumber(batch.firstLine);
+        const int from = block.position();
+        for (int i = 0; i < batch.states.size() && block.isValid(); ++i, block = block.next()) {
+            applyTokens(block, batch.tokens[i]);
+            block.setUserState(batch.states[i]);
+        }
+        markDirty(from, block.isValid() ? block.position() : document->characterCount());
+
+        // The visible lines arrive ahead of the rest, so batches are not in
+        // order; validLines only advances over a gapless run from the start.
+        delivered.insert(batch.firstLine, batch.firstLine + batch.states.size());
+        while (!delivered.isEmpty() && delivered.firstKey() <= validLines) {
+            validLines = qMax(validLines, delivered.first());
+            delivered.erase(delivered.begin());
+        }
+    }
+
+    void applyTokens(QTextBlock &block, const QVector<CodeLexer::Token> &tokens) {
+        QList<QTextLayout::FormatRange> ranges;
+        ranges.reserve(tokens.size());
+        for (const CodeLexer::Token &token : tokens) {
+            QTextLayout::FormatRange range;
+            range.start = token.start;
+            range.length = token.length;
+            range.format = CodeHighlighter::formatFor(token.kind);
+            ranges.append(range);
+        }
+        block.layout()->setFormats(ranges);
+    }
+
+    void markDirty(int from, int to) {
+        if (to > from) {
+            document->markContentsDirty(from, to - from);
+        }
+    }
+
+    QTextDocument *document;
+    CodeLexer::Language language;
+    std::function<TextRope()> snapshot;
+    std::function<QPair<int, int>()> visibleRange;
+    std::shared_ptr<HighlightChannel> channel;
+    QTimer restartTimer;
+    bool passRunning = false;
+    // Lines before validLines have current states; restartLine is where the
+    // next pass has to start, or -1 when none is due
+    int validLines = 0;
+    int restartLine = -1;
+    QMap<int, int> delivered;
+};
+
+// A file mapped into memory and decoded to text chunk by chunk. The
+// mapping is backed by the page cache, so the raw bytes are never copied
+// onto the heap, and only the chunks actually read get decoded. Line
+// endings are normalized to \n like QIODevice::Text used to do.
+class MappedTextSource {
+public:
+    bool open(const QString &path) {
+        file.setFileName(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        total = file.size();
+        data = total > 0 ? reinterpret_cast<const char *>(file.map(0, total)) : nullptr;
+        if (total > 0 && !data) {
+            // Not mappable (pipes, some network filesystems): fall back to a read
+            fallback = file.readAll();
+            data = fallback.constData();
+            total = fallback.size();
+        }
+        return true;
+    }
+
+    QByteArrayView bytes() const {
+        return QByteArrayView(data, total);
+    }
+
+    qint64 size() const {
+        return total;
+    }
+
+    qint64 position() const {
+        return pos;
+    }
+
+    bool atEnd() const {
+        return pos >= total;
+    }
+
+    // Qt's UTF-8 decoder validates as it goes (with its own SIMD ASCII fast
+    // path) and keeps multi-byte sequences split across chunks intact.
+    QString readChunk(qint64 maxBytes) {
+        const qint64 count = qMin(maxBytes, total - pos);
+        QString text = decoder.decode(QByteArrayView(data + pos, count));
+        pos += count;
+
+        if (pendingCarriageReturn) {
+            text.prepend(QLatin1Char('\r'));
+            pendingCarriageReturn = false;
+        }
+        if (!atEnd() && text.endsWith(QLatin1Char('\r'))) {
+            text.chop(1);
+            pendingCarriageReturn = true;
+        }
+        text.replace(QLatin1String("\r\n"), QLatin1String("\n"));
+
+        if (atEnd()) {
+            file.close(); // also unmaps
+            fallback.clear();
+        }
+        return text;
+    }
+
+    QString readAll() {
+        return readChunk(total - pos);
+    }
+
+    bool hasDecodingErrors() const {
+        return decoder.hasError();
+    }
+
+private:
+    QFile file;
+    QByteArray fallback;
+    const char *data = nullptr;
+    qint64 total = 0;
+    qint64 pos = 0;
+    QStringDecoder decoder{QStringDecoder::Utf8};
+    bool pendingCarriageReturn = false;
+};
+
+class CodeEditor;
+
+// Gutter widget; painting is delegated to CodeEditor
+class LineNumberArea : public QWidget {
+public:
+    LineNumberArea(CodeEditor *editor);
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    CodeEditor *codeEditor;
+};
+
+// Custom Text Editor
+class CodeEditor : public QPlainTextEdit {
+    Q_OBJECT
+    
+public:
+    CodeEditor(const QString &fileType = "", QWidget *parent = nullptr) : QPlainTextEdit(parent), currentFileType(fileType) {
+        highlighter = new CodeHighlighter(document(), CodeLexer::languageForFileType(currentFileType));
+        lineNumberArea = new LineNumberArea(this);
+        applyTheme(true); // Default dark theme
+        setupAutoComplete();
+        
+        connect(this, &QPlainTextEdit::textChanged, this, &CodeEditor::onTextChanged);
+        connect(document(), &QTextDocument::contentsChange, this, &CodeEditor::mirrorContentsChange);
+        connect(this, &QPlainTextEdit::blockCountChanged, this, &CodeEditor::updateLineNumberAreaWidth);
+        connect(this, &QPlainTextEdit::updateRequest, this, &CodeEditor::updateLineNumberArea);
+        updateLineNumberAreaWidth(0);
+    }
+
+    void applyTheme(bool isDark) {
+        gutterBackground = isDark ? QColor(37, 37, 38) : QColor(240, 240, 240);
+        gutterForeground = isDark ? QColor(133, 133, 133) : QColor(150, 150, 150);
+        lineNumberArea->update();
+
+        if (isDark) {
+            setStyleSheet(R"(
+                QPlainTextEdit {
+                    background-color: #1e1e1e;
+                    color: #d4d4d4;
+                    border: none;
+                    font-family: 'Consolas', 'Courier New', monospace;
+                    font-size: 14px;
+                }
+            )");
+        } else {
+            setStyleSheet(R"(
+                QPlainTextEdit {
+                    background-color: #ffffff;
+                    color: #000000;
+                    border: none;
+                    font-family: 'Consolas', 'Courier New', monospace;
+                    font-size: 14px;
+                }
+            )");
+        }
+    }
+
+    void setFileType(const QString &type) {
+        currentFileType = type;
+        if (highlighter) {
+            highlighter->setLanguage(CodeLexer::languageForFileType(type));
+        }
+        if (backgroundHighlighter) {
+            backgroundHighlighter->setLanguage(CodeLexer::languageForFileType(type));
+        }
+        if (!largeFileMode) {
+            setupAutoComplete();
+        }
+    }
+
+    // Large-file mode trades editor features for load and layout speed:
+    // no highlighting, no autocomplete, no line wrapping and no undo
+    // history. Call it before setContent().
+    void setLargeFileMode(bool enabled) {
+        largeFileMode = enabled;
+        if (!enabled) {
+            return;
+        }
+        delete highlighter;
+        highlighter = nullptr;
+        delete backgroundHighlighter;
+        backgroundHighlighter = nullptr;
+        delete completer;
+        completer = nullptr;
+
+        setLineWrapMode(QPlainTextEdit::NoWrap);
+        setUndoRedoEnabled(false);
+    }
+
+    bool isLargeFileMode() const {
+        return largeFileMode;
+    }
+
+    // Loads the file text. Large documents are highlighted on a worker
+    // thread, viewport first, instead of synchronously inside setPlainText.
+    void setContent(const QString &text) {
+        if (largeFileMode || text.size() < BackgroundHighlightThreshold) {
+            loadText(text);
+            savedHash = buffer.contentHash();
+            return;
+        }
+        delete highlighter;
+        highlighter = nullptr;
+        loadText(text);
+        savedHash = buffer.contentHash();
+        backgroundHighlighter = new BackgroundHighlighter(document(), CodeLexer::languageForFileType(currentFileType),
+                                                          [this]() { return buffer; },
+                                                          [this]() { return visibleBlockRange(); });
+    }
+
+    // Shows a large file a chunk at a time. The first chunks are decoded
+    // right away; the rest is paged in as the view scrolls towards the end.
+    // The editor stays read-only until the whole file is in.
+    void setPagedSource(MappedTextSource *source) {
+        pagedSource.reset(source);
+        setReadOnly(true);
+        loadText(pagedSource->readChunk(PageBytes * 2));
+        connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &CodeEditor::pageInIfNeeded);
+        // Queued: the range changes during layout, which must not be re-entered
+        connect(verticalScrollBar(), &QScrollBar::rangeChanged, this, &CodeEditor::pageInIfNeeded, Qt::QueuedConnection);
+        finishPagingIfDone();
+    }
+
+    bool isFullyLoaded() const {
+        return !pagedSource;
+    }
+
+    // Hash of the text as last loaded from or saved to disk
+    QByteArray savedContentHash() const {
+        return savedHash;
+    }
+
+    // Bumped on every edit; lets a finished save tell whether the buffer
+    // still matches the snapshot it wrote.
+    quint64 editSerial() const {
+        return edits;
+    }
+
+    void markSaved(const QByteArray &hash, quint64 serial) {
+        savedHash = hash;
+        if (serial == edits) {
+            document()->setModified(false);
+        }
+    }
+
+    // The editor text as an O(1) snapshot, safe to read from other threads
+    TextRope snapshot() const {
+        return buffer;
+    }
+
+    QPair<int, int> visibleBlockRange() const {
+        int first = firstVisibleBlock().blockNumber();
+        int last = cursorForPosition(QPoint(0, viewport()->height())).blockNumber();
+        return qMakePair(first, last);
+    }
+
+    void setLineNumbersVisible(bool visible) {
+        lineNumbersVisible = visible;
+        lineNumberArea->setVisible(visible);
+        updateLineNumberAreaWidth(0);
+    }
+
+    int lineNumberAreaWidth() const {
+        if (!lineNumbersVisible) {
+            return 0;
+        }
+        int digits = 1;
+        for (int max = qMax(1, blockCount()); max >= 10; max /= 10) {
+            ++digits;
+        }
+        return 12 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+    }
+
+    // Paints numbers for the blocks intersecting the exposed rect only, so
+    // the cost is independent of document length.
+    void lineNumberAreaPaintEvent(QPaintEvent *event) {
+        QPainter painter(lineNumberArea);
+        painter.fillRect(event->rect(), gutterBackground);
+        painter.setPen(gutterForeground);
+        painter.setFont(font());
+
+        QTextBlock block = firstVisibleBlock();
+        int blockNumber = block.blockNumber();
+        int top = qRound(blockBoundingGeometry(block).translated(contentOffset()).top());
+        int bottom = top + qRound(blockBoundingRect(block).height());
+        const int width = lineNumberArea->width() - 6;
+
+        while (block.isValid() && top <= event->rect().bottom()) {
+            if (block.isVisible() && bottom >= event->rect().top()) {
+                painter.drawText(0, top, width, fontMetrics().height(), Qt::AlignRight, QString::number(blockNumber + 1));
+            }
+            block = block.next();
+            top = bottom;
+            bottom = top + qRound(blockBoundingRect(block).height());
+            ++blockNumber;
+        }
+    }
+
+    void showImportPanel() {
+        if (currentFileType == "html" || currentFileType == "htm" || 
+            currentFileType == "xhtml" || currentFileType == "xhtm" || currentFileType == "htma") {
+            emit requestImportPanel();
+        }
+    }
+
+signals:
+    void requestImportPanel();
+    void loadProgress(qint64 loaded, qint64 total, bool decodingErrors);
+
+public slots:
+    void onTextChanged() {
+        if (!completer) {
+            return;
+        }
+
+        // Show suggestions as you type
+        QTextCursor cursor = textCursor();
+        cursor.select(QTextCursor::WordUnderCursor);
+        QString word = cursor.selectedText();
+        
+        if (word.length() > 1) {
+            if (completer && completer->completionCount() > 0) {
+                completer->setCompletionPrefix(word);
+                QRect cr = cursorRect();
+                cr.setWidth(completer->popup()->sizeHintForColumn(0) 
+                    + completer->popup()->verticalScrollBar()->sizeHint().width());
+                completer->complete(cr);
+            }
+        }
+    }
+
+protected:
+    void resizeEvent(QResizeEvent *event) override {
+        QPlainTextEdit::resizeEvent(event);
+        QRect cr = contentsRect();
+        lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    }
+
+private slots:
+    // Replays a document edit onto the rope. The document is only the view;
+    // everything that reads the text (save, import, highlight workers)
+    // goes through the rope.
+    void mirrorContentsChange(int position, int charsRemoved, int charsAdded) {
+        if (loadingText) {
+            return;
+        }
+        ++edits;
+        // The document counts its final paragraph separator, the rope does not
+        const int documentLength = document()->characterCount() - 1;
+        buffer.remove(position, charsRemoved);
+        charsAdded = qMin(charsAdded, documentLength - position);
+        if (charsAdded > 0) {
+            QTextCursor cursor(document());
+            cursor.setPosition(position);
+            cursor.setPosition(position + charsAdded, QTextCursor::KeepAnchor);
+            buffer.insert(position, cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n')));
+        }
+        if (buffer.length() != documentLength) {
+            buffer = TextRope(toPlainText());
+        }
+    }
+
+    void pageInIfNeeded() {
+        QScrollBar *bar = verticalScrollBar();
+        if (!pagedSource || bar->value() < bar->maximum() - 2 * bar->pageStep()) {
+            return;
+        }
+        QTextCursor cursor(document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(pagedSource->readChunk(PageBytes));
+        document()->setModified(false);
+        finishPagingIfDone();
+    }
+
+    void updateLineNumberAreaWidth(int newBlockCount) {
+        Q_UNUSED(newBlockCount);
+        setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    }
+
+    void updateLineNumberArea(const QRect &rect, int dy) {
+        if (dy) {
+            lineNumberArea->scroll(0, dy);
+        } else {
+            lineNumberArea->update(0, rect.y(), lineNumberArea->width(), rect.height());
+        }
+        if (rect.contains(viewport()->rect())) {
+            updateLineNumberAreaWidth(0);
+        }
+    }
+
+private:
+    void setupAutoComplete() {
+        QStringList suggestions;
+        
+        if (currentFileType == "html" || currentFileType == "htm" || 
+            currentFileType == "xhtml" || currentFileType == "xhtm" || currentFileType == "htma") {
+            suggestions << "<!DOCTYPE html>" << "<html>" << "</html>" << "<head>" << "</head>"
+                       << "<body>" << "</body>" << "<div>" << "</div>" << "<span>" << "</span>"
+                       << "<script>" << "</script>" << "<link>" << "<style>" << "</style>"
+                       << "<title>" << "</title>" << "<meta>" << "<form>" << "</form>"
+                       << "<input>" << "<button>" << "</button>" << "<a>" << "</a>"
+                       << "<img>" << "<ul>" << "</ul>" << "<li>" << "</li>" << "<p>" << "</p>"
+                       << "<h1>" << "</h1>" << "<h2>" << "</h2>" << "<h3>" << "</h3>"
+                       << "<table>" << "</table>" << "<tr>" << "</tr>" << "<td>" << "</td>"
+                       << "class=\"\"" << "id=\"\"" << "href=\"\"" << "src=\"\"";
+        } else if (currentFileType == "css") {
+            suggestions << "background-color:" << "color:" << "font-size:" << "margin:" << "padding:"
+                       << "width:" << "height:" << "display:" << "position:" << "border:"
+                       << "flex" << "grid" << "absolute" << "relative" << "fixed"
+                       << "background:" << "border-radius:" << "box-shadow:" << "text-align:"
+                       << "font-family:" << "font-weight:" << "line-height:" << "opacity:"
+                       << "transition:" << "transform:" << "justify-content:" << "align-items:";
+        } else if (currentFileType == "js") {
+            suggestions << "function" << "const" << "let" << "var" << "return" << "if" << "else"
+                       << "for" << "while" << "switch" << "case" << "break" << "continue"
+                       << "document.getElementById" << "document.querySelector"
+                       << "document.querySelectorAll" << "addEventListener" << "console.log"
+                       << "fetch" << "async" << "await" << "Promise" << "setTimeout" << "setInterval"
+                       << "class" << "constructor" << "this" << "new" << "export" << "import";
+        }
+        
+        if (!suggestions.isEmpty()) {
+            completer = new QCompleter(suggestions, this);
+            completer->setWidget(this);
+            completer->setCompletionMode(QCompleter::PopupCompletion);
+            completer->setCaseSensitivity(Qt::CaseInsensitive);
+            
+            connect(completer, QOverload<const QString &>::of(&QCompleter::activated),
+                    this, &CodeEditor::insertCompletion);
+        }
+    }
+
+    void finishPagingIfDone() {
+        emit loadProgress(pagedSource->position(), pagedSource->size(), pagedSource->hasDecodingErrors());
+        if (pagedSource->atEnd()) {
+            disconnect(verticalScrollBar(), &QScrollBar::valueChanged, this, &CodeEditor::pageInIfNeeded);
+            disconnect(verticalScrollBar(), &QScrollBar::rangeChanged, this, &CodeEditor::pageInIfNeeded);
+            pagedSource.reset();
+            setReadOnly(false);
+            savedHash = buffer.contentHash();
+        }
+    }
+
+    void loadText(const QString &text) {
+        loadingText = true;
+        setPlainText(text);
+        loadingText = false;
+        buffer = TextRope(text);
+        if (buffer.length() != document()->characterCount() - 1) {
+            buffer = TextRope(toPlainText()); // setPlainText normalized the line endings
+        }
+    }
+
+    void insertCompletion(const QString &completion) {
+        QTextCursor cursor = textCursor();
+        cursor.select(QTextCursor::WordUnderCursor);
+        cursor.removeSelectedText();
+        cursor.insertText(completion);
+        setTextCursor(cursor);
+    }
+
+    static const int BackgroundHighlightThreshold = 512 * 1024;
+    static const qint64 PageBytes = 1024 * 1024;
+
+    CodeHighlighter *highlighter = nullptr;
+    BackgroundHighlighter *backgroundHighlighter = nullptr;
+    QCompleter *completer = nullptr;
+    QString currentFileType;
+    bool largeFileMode = false;
+    LineNumberArea *lineNumberArea;
+    bool lineNumbersVisible = true;
+    TextRope buffer;
+    bool loadingText = false;
+    std::unique_ptr<MappedTextSource> pagedSource;
+    QByteArray savedHash;
+    quint64 edits = 0;
+    QColor gutterBackground;
+    QColor gutterForeground;
+};
+
+inline LineNumberArea::LineNumberArea(CodeEditor *editor) : QWidget(editor), codeEditor(editor) {
+}
+
+inline QSize LineNumberArea::sizeHint() const {
+    return QSize(codeEditor->lineNumberAreaWidth(), 0);
+}
+
+inline void LineNumberArea::paintEvent(QPaintEvent *event) {
+    codeEditor->lineNumberAreaPaintEvent(event);
+}
+
+// Writes editor snapshots to disk on a small thread pool. Each file is
+// encoded on the worker and written through QSaveFile, which writes a
+// temporary file, syncs it and renames it over the target, so a failed
+// save never leaves a truncated file behind. Saves of the same path are
+// serialized; a newer snapshot queued behind a running save replaces any
+// older one still waiting. A save given the hash of what is already on
+// disk compares it on the worker and skips the write when nothing changed.
+class SaveQueue : public QObject {
+    Q_OBJECT
+
+public:
+    SaveQueue(QObject *parent = nullptr) : QObject(parent) {
+        pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+    }
+
+    ~SaveQueue() {
+        // Let in-flight writes finish before the application goes away
+        pool.waitForDone();
+    }
+
+    void save(const QString &path, const TextRope &snapshot, const QByteArray &skipIfHash = QByteArray()) {
+        if (running.contains(path)) {
+            waiting.insert(path, Job{snapshot, skipIfHash});
+            return;
+        }
+        start(path, Job{snapshot, skipIfHash});
+    }
+
+    bool isSaving(const QString &path) const {
+        return running.contains(path) || waiting.contains(path);
+    }
+
+signals:
+    void saveFinished(const QString &path, bool ok, const QString &error, const QByteArray &hash, bool skipped);
+
+private:
+    struct Job {
+        TextRope snapshot;
+        QByteArray skipIfHash;
+    };
+
+    void start(const QString &path, const Job &job) {
+        running.insert(path);
+        SaveQueue *queue = this;
+        pool.start([queue, path, job]() {
+            const QByteArray hash = job.snapshot.contentHash();
+            if (!job.skipIfHash.isEmpty() && hash == job.skipIfHash) {
+                QMetaObject::invokeMethod(queue, [queue, path, hash]() {
+                    queue->finish(path, QString(), hash, true);
+                }, Qt::QueuedConnection);
+                return;
+            }
+
+            QString error;
+            QSaveFile file(path);
+            if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                QTextStream out(&file);
+                job.snapshot.forEachChunk([&out](QStringView chunk) { out << chunk; });
+                out.flush();
+                if (out.status() != QTextStream::Ok) {
+                    error = file.errorString();
+                    file.cancelWriting();
+                }
+                if (!file.commit() && error.isEmpty()) {
+                    error = file.errorString();
+                }
+            } else {
+                error = file.errorString();
+            }
+            // The pool is drained in ~SaveQueue, so queue outlives this call
+            QMetaObject::invokeMethod(queue, [queue, path, error, hash]() {
+                queue->finish(path, error, hash, false);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    void finish(const QString &path, const QString &error, const QByteArray &hash, bool skipped) {
+        running.remove(path);
+        emit saveFinished(path, error.isEmpty(), error, hash, skipped);
+        if (waiting.contains(path)) {
+            start(path, waiting.take(path));
+        }
+    }
+
+    QThreadPool pool;
+    QSet<QString> running;
+    QHash<QString, Job> waiting;
+};
+
+// Decides which project entries the explorer, the export dialog and the
+// preview server's index leave out: the user's exclude patterns plus the
+// project's .gitignore files, with the usual .gitignore syntax (negation,
+// trailing '/' for folders, leading '/' or an inner '/' to anchor, "**").
+// Patterns are compiled to regular expressions once. A folder's .gitignore
+// is read the first time something inside it is tested and then kept until
+// invalidate() drops it. Paths are relative to the project root and have no
+// leading slash; the root itself is "".
+class IgnoreMatcher {
+    struct Rule {
+        QRegularExpression pattern;
+        bool negated = false;
+        bool directoryOnly = false;
+        // Matched against the path below the rule's folder, not just the name
+        bool anchored = false;
+    };
+    using Rules = std::shared_ptr<const QVector<Rule>>;
+
+public:
+    // The rules that apply to the entries of one folder
+    class Scope {
+    public:
+        bool ignores(const QString &name, bool directory) const {
+            const QString path = folder.isEmpty() ? name : folder + QLatin1Char('/') + name;
+            // Later rules and deeper .gitignore files win
+            bool ignored = false;
+            for (const Level &level : levels) {
+                const QString below = path.mid(level.prefix);
+                for (const Rule &rule : *level.rules) {
+                    if (rule.directoryOnly && !directory) continue;
+                    if (rule.pattern.match(rule.anchored ? below : name).hasMatch()) {
+                        ignored = !rule.negated;
+                    }
+                }
+            }
+            return ignored;
+        }
+
+    private:
+        friend class IgnoreMatcher;
+        struct Level {
+            int prefix;
+            Rules rules;
+        };
+        QString folder;
+        QVector<Level> levels;
+    };
+
+    IgnoreMatcher(const QString &root, const QStringList &excludes) : root(root) {
+        auto rules = std::make_shared<QVector<Rule>>();
+        for (const QString &line : excludes) {
+            compile(line, *rules);
+        }
+        this->excludes = rules;
+    }
+
+    QString relativePath(const QString &absolute) const {
+        return absolute.size() <= root.size() ? QString("") : absolute.mid(root.size() + 1);
+    }
+
+    Scope scope(const QString &folder) const {
+        Scope scope;
+        scope.folder = folder;
+        scope.levels.append(Scope::Level{0, excludes});
+        int end = 0;
+        for (;;) {
+            const QString ancestor = folder.left(end);
+            const Rules rules = rulesFor(ancestor);
+            if (!rules->isEmpty()) {
+                scope.levels.append(Scope::Level{ancestor.isEmpty() ? 0 : int(ancestor.size()) + 1, rules});
+            }
+            if (end >= folder.size()) break;
+            end = folder.indexOf(QLatin1Char('/'), end + 1);
+            if (end < 0) end = folder.size();
+        }
+        return scope;
+    }
+
+    // Lets a caller that has just listed folder skip the read when it knows
+    // there is no .gitignore in it
+    void noteFolder(const QString &folder, bool hasIgnoreFile) const {
+        QWriteLocker locker(&lock);
+        if (hasIgnoreFile) {
+            // A listing that raced with the file's creation noted it as missing
+            if (folders.value(folder) == noIgnoreFile) {
+                folders.remove(folder);
+            }
+        } else if (!folders.contains(folder)) {
+            folders.insert(folder, noIgnoreFile);
+        }
+    }
+
+    // The folder's .gitignore changed; it is read again the next time
+    // something inside the folder is tested
+    void invalidate(const QString &folder) const {
+        QWriteLocker locker(&lock);
+        folders.remove(folder);
+        ++epoch;
+    }
+
+private:
+    Rules rulesFor(const QString &folder) const {
+        quint64 seen;
+        {
+            QReadLocker locker(&lock);
+            const auto it = folders.constFind(folder);
+            if (it != folders.constEnd()) return it.value();
+            seen = epoch;
+        }
+        auto rules = std::make_shared<QVector<Rule>>();
+        QFile file((folder.isEmpty() ? root : root + QLatin1Char('/') + folder) + "/.gitignore");
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            const QStringList lines = QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'));
+            for (const QString &line : lines) {
+                compile(line, *rules);
+            }
+        }
+        QWriteLocker locker(&lock);
+        // A read that overlapped invalidate() may have seen the old file
+        if (epoch == seen) {
+            folders.insert(folder, rules);
+        }
+        return rules;
+    }
+
+    static void compile(const QString &line, QVector<Rule> &rules) {
+        QString glob = line.trimmed();
+        if (glob.isEmpty() || glob.startsWith(QLatin1Char('#'))) return;
+        Rule rule;
+        if (glob.startsWith(QLatin1Char('!'))) {
+            rule.negated = true;
+            glob.remove(0, 1);
+        } else if (glob.startsWith(QLatin1String("\\!")) || glob.startsWith(QLatin1String("\\#"))) {
+            glob.remove(0, 1);
+        }
+        if (glob.endsWith(QLatin1Char('/'))) {
+            rule.directoryOnly = true;
+            glob.chop(1);
+        }
+        if (glob.startsWith(QLatin1Char('/'))) {
+            rule.anchored = true;
+            glob.remove(0, 1);
+        } else {
+            rule.anchored = glob.contains(QLatin1Char('/'));
+        }
+        if (glob.isEmpty()) return;
+        rule.pattern = QRegularExpression(globToRegularExpression(glob));
+        if (rule.pattern.isValid()) {
+            rules.append(rule);
+        }
+    }
+
+    // '*' and '?' stop at '/', "**/" spans any number of folders and a
+    // trailing "**" everything below
+    static QString globToRegularExpression(const QString &glob) {
+        QString pattern;
+        for (int i = 0; i < glob.size(); ++i) {
+            const QChar c = glob.at(i);
+            if (c == QLatin1Char('*')) {
+                if (i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('*')) {
+                    ++i;
+                    if (i + 1 < glob.size() && glob.at(i + 1) == QLatin1Char('/')) {
+                        ++i;
+                        pattern += "(?:.*/)?";
+                    } else {
+                        pattern += ".*";
+                    }
+                } else {
+                    pattern += "[^/]*";
+                }
+            } else if (c == QLatin1Char('?')) {
+                pattern += "[^/]";
+            } else if (c == QLatin1Char('[') && glob.indexOf(QLatin1Char(']'), i + 1) > i + 1) {
+                const int close = glob.indexOf(QLatin1Char(']'), i + 1);
+                QString set = glob.mid(i + 1, close - i - 1);
+                if (set.startsWith(QLatin1Char('!'))) set[0] = QLatin1Char('^');
+                pattern += QLatin1Char('[') + set.replace(QLatin1Char('\\'), QLatin1String("\\\\")) + QLatin1Char(']');
+                i = close;
+            } else if (c == QLatin1Char('\\') && i + 1 < glob.size()) {
+                pattern += QRegularExpression::escape(glob.mid(++i, 1));
+            } else {
+                pattern += QRegularExpression::escape(QString(c));
+            }
+        }
+        return QRegularExpression::anchoredPattern(pattern);
+    }
+
+    QString root;
+    Rules excludes;
+    // Shared by folders a listing found without a .gitignore
+    const Rules noIgnoreFile = std::make_shared<const QVector<Rule>>();
+    mutable QReadWriteLock lock;
+    mutable QHash<QString, Rules> folders;
+    mutable quint64 epoch = 0;
+};
+
+// Explorer order: folders first, then by name
+static bool entryBefore(bool aDirectory, const QString &a, bool bDirectory, const QString &b) {
+    if (aDirectory != bDirectory) return aDirectory;
+    return a < b;
+}
+
+// One entry of a directory listed by DirectoryCrawler
+struct CrawlEntry {
+    QString name;
+    bool directory = false;
+};
+
+// The visible entries of one directory, directories first. ok is false when
+// the directory could not be opened.
+struct CrawlListing {
+    QString path;
+    QVector<CrawlEntry> entries;
+    bool ok = false;
+};
+
+// Lists directories on a pool of worker threads. Requests go onto one shared
+// stack that every idle worker pulls from, so expanding many folders at once
+// (or one huge one next to small ones) keeps all threads busy. Listings reach
+// the GUI thread in batches through listed(). Entries the ignore matcher
+// rejects are dropped from the listing, so they are never entered.
+class DirectoryCrawler : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int BatchSize = 512;
+
+    DirectoryCrawler(QObject *parent = nullptr) : QObject(parent) {
+        pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 8));
+    }
+
+    ~DirectoryCrawler() {
+        abandon();
+        pool.waitForDone();
+    }
+
+    // Applies to listings requested from now on
+    void setIgnoreMatcher(const std::shared_ptr<const IgnoreMatcher> &ignore) {
+        matcher = ignore;
+        if (job) {
+            QMutexLocker locker(&job->mutex);
+            job->drained = true;
+        }
+    }
+
+    void list(const QString &path) {
+        if (job) {
+            QMutexLocker locker(&job->mutex);
+            if (!job->drained) {
+                job->pending.append(path);
+                job->wake.wakeOne();
+                return;
+            }
+        }
+        // The previous job's workers have all left; its last batches and
+        // finished() are still queued and are delivered as usual
+        auto crawl = std::make_shared<Crawl>();
+        crawl->pending.append(path);
+        crawl->matcher = matcher;
+        crawl->workers.storeRelaxed(pool.maxThreadCount());
+        job = crawl;
+        directories = 0;
+        files = 0;
+
+        DirectoryCrawler *crawler = this;
+        for (int i = 0; i < pool.maxThreadCount(); ++i) {
+            pool.start([crawler, crawl]() { work(crawler, crawl); });
+        }
+        emit started();
+    }
+
+    // Listings already queued for the GUI thread are dropped as well
+    void cancel() {
+        if (!job) return;
+        abandon();
+        emit finished(true);
+    }
+
+    bool isRunning() const {
+        return bool(job);
+    }
+
+signals:
+    void started();
+    void listed(const QVector<CrawlListing> &listings);
+    void progress(int directories, int files);
+    void finished(bool cancelled);
+
+private:
+    struct Crawl {
+        QMutex mutex;
+        QWaitCondition wake;
+        QStringList pending;
+        int active = 0;
+        bool drained = false;
+        std::shared_ptr<const IgnoreMatcher> matcher;
+        QAtomicInt cancelled;
+        QAtomicInt workers;
+    };
+
+    void abandon() {
+        if (!job) return;
+        {
+            QMutexLocker locker(&job->mutex);
+            job->cancelled.storeRelaxed(1);
+        }
+        job->wake.wakeAll();
+        job.reset();
+    }
+
+    static void work(DirectoryCrawler *crawler, const std::shared_ptr<Crawl> &crawl) {
+        QVector<CrawlListing> batch;
+        int batchEntries = 0;
+        for (;;) {
+            QString path;
+            {
+                QMutexLocker locker(&crawl->mutex);
+                // Hand over what we have before going idle
+                if (crawl->pending.isEmpty() && !batch.isEmpty()) {
+                    locker.unlock();
+                    deliver(crawler, crawl, std::move(batch));
+                    batch = QVector<CrawlListing>();
+                    batchEntries = 0;
+                    locker.relock();
+                }
+                while (crawl->pending.isEmpty() && crawl->active > 0 && !crawl->cancelled.loadRelaxed()) {
+                    crawl->wake.wait(&crawl->mutex);
+                }
+                if (crawl->cancelled.loadRelaxed() || crawl->pending.isEmpty()) {
+                    crawl->drained = true;
+                    break;
+                }
+                path = crawl->pending.takeLast();
+                ++crawl->active;
+            }
+
+            CrawlListing listing;
+            listing.path = path;
+            listing.ok = readDirectory(path, listing.entries, crawl->matcher.get());
+            batchEntries += listing.entries.size() + 1;
+            batch.append(std::move(listing));
+            {
+                QMutexLocker locker(&crawl->mutex);
+                --crawl->active;
+            }
+            // Wake everyone when the crawl has just run dry so they can exit
+            crawl->wake.wakeAll();
+
+            if (batchEntries >= BatchSize) {
+                deliver(crawler, crawl, std::move(batch));
+                batch = QVector<CrawlListing>();
+                batchEntries = 0;
+            }
+        }
+        crawl->wake.wakeAll();
+        // The last worker out reports the end; every batch was queued first
+        if (!crawl->workers.deref()) {
+            // The pool is drained in ~DirectoryCrawler, so crawler outlives this call
+            QMetaObject::invokeMethod(crawler, [crawler, crawl]() {
+                if (crawler->job != crawl) return;
+                crawler->job.reset();
+                emit crawler->finished(false);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    static void deliver(DirectoryCrawler *crawler, const std::shared_ptr<Crawl> &crawl, QVector<CrawlListing> batch) {
+        QMetaObject::invokeMethod(crawler, [crawler, crawl, batch]() {
+            if (crawl->cancelled.loadRelaxed()) return;
+            for (const CrawlListing &listing : batch) {
+                ++crawler->directories;
+                crawler->files += listing.entries.size();
+            }
+            emit crawler->listed(batch);
+            if (crawler->job == crawl) {
+                emit crawler->progress(crawler->directories, crawler->files);
+            }
+        }, Qt::QueuedConnection);
+    }
+
+    // Lists one directory's visible entries, directories first. Symlinked
+    // directories count as directories. On POSIX the entry type comes from
+    // readdir's d_type and only symlinks and filesystems that report
+    // DT_UNKNOWN cost a stat.
+    static bool readDirectory(const QString &path, QVector<CrawlEntry> &entries, const IgnoreMatcher *matcher) {
+        const QString folder = matcher ? matcher->relativePath(path) : QString();
+#ifdef Q_OS_UNIX
+        DIR *dir = opendir(QFile::encodeName(path).constData());
+        if (!dir) return false;
+        const int fd = dirfd(dir);
+        bool hasIgnoreFile = false;
+        while (const dirent *entry = readdir(dir)) {
+            // Hidden entries, "." and ".." are skipped like QDir does without QDir::Hidden
+            if (entry->d_name[0] == '.') {
+                hasIgnoreFile = hasIgnoreFile || strcmp(entry->d_name, ".gitignore") == 0;
+                continue;
+            }
+            unsigned char type = entry->d_type;
+            struct stat info;
+            if (type == DT_UNKNOWN && fstatat(fd, entry->d_name, &info, AT_SYMLINK_NOFOLLOW) == 0) {
+                type = S_ISDIR(info.st_mode) ? DT_DIR : S_ISLNK(info.st_mode) ? DT_LNK : DT_REG;
+            }
+            bool directory = type == DT_DIR;
+            if (type == DT_LNK) {
+                directory = fstatat(fd, entry->d_name, &info, 0) == 0 && S_ISDIR(info.st_mode);
+            }
+            entries.append(CrawlEntry{QFile::decodeName(entry->d_name), directory});
+        }
+        closedir(dir);
+        if (matcher) {
+            matcher->noteFolder(folder, hasIgnoreFile);
+        }
+#else
+        if (!QFileInfo(path).isDir()) return false;
+        QDirIterator it(path, QDir::AllEntries | QDir::NoDotAndDotDot);
+        while (it.hasNext()) {
+            it.next();
+            const QFileInfo info = it.fileInfo();
+            entries.append(CrawlEntry{info.fileName(), info.isDir()});
+        }
+#endif
+        if (matcher) {
+            const IgnoreMatcher::Scope scope = matcher->scope(folder);
+            entries.erase(std::remove_if(entries.begin(), entries.end(), [&scope](const CrawlEntry &entry) {
+                return scope.ignores(entry.name, entry.directory);
+            }), entries.end());
+        }
+        std::sort(entries.begin(), entries.end(), [](const CrawlEntry &a, const CrawlEntry &b) {
+            return entryBefore(a.directory, a.name, b.directory, b.name);
+        });
+        return true;
+    }
+
+    QThreadPool pool;
+    std::shared_ptr<Crawl> job;
+    std::shared_ptr<const IgnoreMatcher> matcher;
+    int directories = 0;
+    int files = 0;
+};
+
+static QIcon fileIcon(const QString &name) {
+    QStyle *style = QApplication::style();
+    QString ext = QFileInfo(name).suffix().toLower();
+    if (ext == "html" || ext == "htm" || ext == "xhtml") {
+        return style->standardIcon(QStyle::SP_FileDialogDetailedView);
+    } else if (ext == "css") {
+        return style->standardIcon(QStyle::SP_FileDialogContentsView);
+    } else if (ext == "js") {
+        return style->standardIcon(QStyle::SP_CommandLink);
+    } else if (ext == "php") {
+        return style->standardIcon(QStyle::SP_ComputerIcon);
+    } else if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "gif" || ext == "bmp" || ext == "svg") {
+        return style->standardIcon(QStyle::SP_FileDialogInfoView);
+    } else if (ext == "json" || ext == "xml") {
+        return style->standardIcon(QStyle::SP_FileDialogListView);
+    }
+    return style->standardIcon(QStyle::SP_FileIcon);
+}
+
+// One filesystem change reported by TreeWatcher. to is only set for renames.
+struct TreeChange {
+    enum Kind { Created, Removed, Renamed };
+
+    Kind kind;
+    QString path;
+    QString to;
+    bool directory = false;
+};
+
+// Watches a set of folders: the ones the explorer has listed, or the whole
+// served tree for the preview server's PathIndex. On Linux this is one inotify
+// descriptor read from a QSocketNotifier; each event names the entry that
+// changed, so the tree can be patched without listing anything. Elsewhere
+// QFileSystemWatcher only says which folder changed, and that folder is
+// reported as dirty to be listed again; files in it modified since it was
+// last checked are reported as written. Events are coalesced for CoalesceMs.
+// A folder with more than StormLimit changes in one window (git checkout,
+// npm install) is reported as dirty instead of entry by entry, and a kernel
+// queue overflow is reported through overflowed().
+class TreeWatcher : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int CoalesceMs = 100;
+    static constexpr int StormLimit = 64;
+
+    TreeWatcher(QObject *parent = nullptr) : QObject(parent) {
+        coalesceTimer.setSingleShot(true);
+        coalesceTimer.setInterval(CoalesceMs);
+        connect(&coalesceTimer, &QTimer::timeout, this, &TreeWatcher::flush);
+#ifdef Q_OS_LINUX
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0) {
+            notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, &TreeWatcher::readEvents);
+            return;
+        }
+#endif
+        fallback = new QFileSystemWatcher(this);
+        connect(fallback, &QFileSystemWatcher::directoryChanged, this, [this](const QString &path) {
+            dirty.insert(path);
+            coalesceTimer.start();
+        });
+    }
+
+    ~TreeWatcher() {
+#ifdef Q_OS_LINUX
+        if (fd >= 0) {
+            ::close(fd);
+        }
+#endif
+    }
+
+    void watch(const QString &directory) {
+        if (watches.contains(directory)) return;
+#ifdef Q_OS_LINUX
+        if (fd >= 0) {
+            const int wd = inotify_add_watch(fd, QFile::encodeName(directory).constData(),
+                                             IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                             | IN_CLOSE_WRITE | IN_ONLYDIR | IN_EXCL_UNLINK);
+            if (wd < 0) return;
+            // Watching a path again returns the descriptor it already has
+            directories.insert(wd, directory);
+            watches.insert(directory, wd);
+            return;
+        }
+#endif
+        if (fallback->addPath(directory)) {
+            watches.insert(directory, 0);
+            checked.insert(directory, QDateTime::currentDateTimeUtc());
+        }
+    }
+
+    // Stops watching directory and every folder below it
+    void unwatch(const QString &directory) {
+        const QString prefix = directory + QLatin1Char('/');
+        QStringList paths;
+        for (auto it = watches.begin(); it != watches.end();) {
+            if (it.key() != directory && !it.key().startsWith(prefix)) {
+                ++it;
+                continue;
+            }
+#ifdef Q_OS_LINUX
+            if (fd >= 0) {
+                inotify_rm_watch(fd, it.value());
+                directories.remove(it.value());
+            }
+#endif
+            paths.append(it.key());
+            checked.remove(it.key());
+            it = watches.erase(it);
+        }
+        if (fallback && !paths.isEmpty()) {
+            fallback->removePaths(paths);
+        }
+    }
+
+    void clear() {
+#ifdef Q_OS_LINUX
+        if (fd >= 0) {
+            for (const int wd : std::as_const(watches)) {
+                inotify_rm_watch(fd, wd);
+            }
+            directories.clear();
+        }
+#endif
+        if (fallback && !watches.isEmpty()) {
+            fallback->removePaths(watches.keys());
+        }
+        watches.clear();
+        checked.clear();
+        pending.clear();
+        dirty.clear();
+        written.clear();
+        ignoreFiles.clear();
+        overflow = false;
+        coalesceTimer.stop();
+    }
+
+signals:
+    void changed(const QVector<TreeChange> &changes);
+    // Something in this folder changed but the watcher cannot say what
+    void directoryDirty(const QString &path);
+    void fileWritten(const QString &path);
+    // The .gitignore in this folder was written, created or removed
+    void ignoreFileChanged(const QString &folder);
+    // Events were lost; every watched folder may be stale
+    void overflowed();
+
+private:
+#ifdef Q_OS_LINUX
+    void readEvents() {
+        alignas(inotify_event) char buffer[64 * 1024];
+        for (;;) {
+            const ssize_t size = ::read(fd, buffer, sizeof buffer);
+            if (size <= 0) break;
+            for (const char *p = buffer; p < buffer + size;) {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+                p += sizeof(inotify_event) + event->len;
+                handle(*event);
+            }
+        }
+        if (!coalesceTimer.isActive()) {
+            coalesceTimer.start();
+        }
+    }
+
+    void handle(const inotify_event &event) {
+        if (event.mask & IN_Q_OVERFLOW) {
+            overflow = true;
+            return;
+        }
+        const QString directory = directories.value(event.wd);
+        if (directory.isEmpty()) return;
+        if (event.mask & IN_IGNORED) {
+            // The folder itself went away; its parent reports that
+            directories.remove(event.wd);
+            watches.remove(directory);
+            return;
+        }
+        if (!event.len) return;
+        const QString name = QFile::decodeName(event.name);
+        // Hidden entries are not in the tree, but a .gitignore decides what is
+        if (name.startsWith(QLatin1Char('.'))) {
+            if (name == QLatin1String(".gitignore")) {
+                ignoreFiles.insert(directory);
+            }
+            return;
+        }
+        const QString path = directory + QLatin1Char('/') + name;
+        const bool isDirectory = event.mask & IN_ISDIR;
+
+        if (event.mask & IN_CLOSE_WRITE) {
+            written.insert(path);
+        } else if (event.mask & IN_CREATE) {
+            pending.append(Event{TreeChange{TreeChange::Created, path, QString(), isDirectory}, 0});
+        } else if (event.mask & IN_DELETE) {
+            pending.append(Event{TreeChange{TreeChange::Removed, path, QString(), isDirectory}, 0});
+        } else if (event.mask & IN_MOVED_FROM) {
+            pending.append(Event{TreeChange{TreeChange::Removed, path, QString(), isDirectory}, event.cookie});
+        } else if (event.mask & IN_MOVED_TO) {
+            // The matching IN_MOVED_FROM comes right before it when the move stays inside watched folders
+            for (int i = pending.size() - 1; i >= 0; --i) {
+                Event &from = pending[i];
+                if (from.cookie != event.cookie || from.change.kind != TreeChange::Removed) continue;
+                from.change.kind = TreeChange::Renamed;
+                from.change.to = path;
+                from.cookie = 0;
+                if (isDirectory) {
+                    moveWatches(from.change.path, path);
+                }
+                return;
+            }
+            pending.append(Event{TreeChange{TreeChange::Created, path, QString(), isDirectory}, 0});
+        }
+    }
+
+    // inotify keeps watching a renamed folder, only its path changes
+    void moveWatches(const QString &from, const QString &to) {
+        const QString prefix = from + QLatin1Char('/');
+        QHash<QString, int> moved;
+        for (auto it = watches.begin(); it != watches.end();) {
+            if (it.key() == from || it.key().startsWith(prefix)) {
+                const QString path = to + it.key().mid(from.size());
+                directories.insert(it.value(), path);
+                moved.insert(path, it.value());
+                it = watches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        watches.insert(moved);
+    }
+#endif
+
+    void flush() {
+        if (overflow) {
+            pending.clear();
+            dirty.clear();
+            written.clear();
+            ignoreFiles.clear();
+            overflow = false;
+            emit overflowed();
+            return;
+        }
+
+        // A file created and deleted inside one window never shows up, and
+        // one created and renamed (an atomic save) shows up under its new name
+        QHash<QString, int> created;
+        QVector<bool> dropped(pending.size(), false);
+        QHash<QString, int> counts;
+        for (int i = 0; i < pending.size(); ++i) {
+            TreeChange &change = pending[i].change;
+            if (change.kind == TreeChange::Created) {
+                created.insert(change.path, i);
+            } else if (change.kind == TreeChange::Removed && created.contains(change.path)) {
+                dropped[created.take(change.path)] = true;
+                dropped[i] = true;
+                continue;
+            } else if (change.kind == TreeChange::Renamed && created.contains(change.path)) {
+                dropped[created.take(change.path)] = true;
+                if (written.remove(change.path)) {
+                    written.insert(change.to);
+                }
+                change = TreeChange{TreeChange::Created, change.to, QString(), change.directory};
+                created.insert(change.path, i);
+            } else if (!change.directory && change.kind != TreeChange::Created) {
+                // Renaming a finished file over the old one is how many editors save
+                written.remove(change.path);
+                if (change.kind == TreeChange::Renamed) {
+                    written.insert(change.to);
+                }
+            }
+            ++counts[parentOf(change.path)];
+            if (change.kind == TreeChange::Renamed) {
+                ++counts[parentOf(change.to)];
+            }
+        }
+        for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+            if (it.value() > StormLimit) {
+                dirty.insert(it.key());
+            }
+        }
+
+        QVector<TreeChange> changes;
+        for (int i = 0; i < pending.size(); ++i) {
+            if (dropped.at(i)) continue;
+            TreeChange change = pending.at(i).change;
+            // A move out of the watched folders leaves a stale inotify watch behind
+            if (change.kind == TreeChange::Removed && change.directory) {
+                unwatch(change.path);
+            }
+            const bool fromDirty = dirty.contains(parentOf(change.path));
+            if (change.kind == TreeChange::Renamed) {
+                const bool toDirty = dirty.contains(parentOf(change.to));
+                if (fromDirty && toDirty) continue;
+                if (fromDirty) {
+                    change = TreeChange{TreeChange::Created, change.to, QString(), change.directory};
+                } else if (toDirty) {
+                    change = TreeChange{TreeChange::Removed, change.path, QString(), change.directory};
+                }
+            } else if (fromDirty) {
+                continue;
+            }
+            changes.append(change);
+        }
+        pending.clear();
+
+        if (!changes.isEmpty()) {
+            emit changed(changes);
+        }
+        for (const QString &path : std::as_const(dirty)) {
+            if (fallback) {
+                noteWrites(path);
+            }
+            emit directoryDirty(path);
+        }
+        dirty.clear();
+        for (const QString &path : std::as_const(written)) {
+            emit fileWritten(path);
+        }
+        written.clear();
+        for (const QString &folder : std::as_const(ignoreFiles)) {
+            emit ignoreFileChanged(folder);
+        }
+        ignoreFiles.clear();
+    }
+
+    static QString parentOf(const QString &path) {
+        return path.left(path.lastIndexOf(QLatin1Char('/')));
+    }
+
+    // QFileSystemWatcher does not say which file changed, so the files
+    // modified since the folder was last checked count as written
+    void noteWrites(const QString &directory) {
+        const auto it = checked.find(directory);
+        if (it == checked.end()) return;
+        const QDateTime since = it.value();
+        it.value() = QDateTime::currentDateTimeUtc();
+        const QFileInfoList files = QDir(directory).entryInfoList(QDir::Files | QDir::Hidden);
+        for (const QFileInfo &info : files) {
+            if (info.lastModified() < since) continue;
+            if (info.fileName() == QLatin1String(".gitignore")) {
+                ignoreFiles.insert(directory);
+            } else if (!info.fileName().startsWith(QLatin1Char('.'))) {
+                written.insert(info.filePath());
+            }
+        }
+    }
+
+    struct Event {
+        TreeChange change;
+        // Pairs IN_MOVED_FROM with IN_MOVED_TO
+        quint32 cookie;
+    };
+
+#ifdef Q_OS_LINUX
+    int fd = -1;
+    QSocketNotifier *notifier = nullptr;
+    QHash<int, QString> directories;
+#endif
+    QFileSystemWatcher *fallback = nullptr;
+    QHash<QString, int> watches;
+    QVector<Event> pending;
+    QSet<QString> dirty;
+    QSet<QString> written;
+    QSet<QString> ignoreFiles;
+    // Fallback only: when each watched folder's files were last checked
+    QHash<QString, QDateTime> checked;
+    bool overflow = false;
+    QTimer coalesceTimer;
+};
+
+// Explorer tree over the project folder. A directory's children are only
+// listed, on the DirectoryCrawler, the first time the view asks for them
+// (canFetchMore/fetchMore), so memory follows what has been expanded rather
+// than the size of the project. The single top-level row is the project
+// folder itself. Qt::UserRole holds an item's absolute path.
+//
+// Listed folders are watched by a TreeWatcher and patched row by row as
+// entries appear, disappear or are renamed. A folder the watcher cannot
+// describe is listed again and merged into the rows it already has.
+class FileTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+
+public:
+    FileTreeModel(DirectoryCrawler *crawler, TreeWatcher *watcher, QObject *parent = nullptr)
+        : QAbstractItemModel(parent), crawler(crawler), watcher(watcher) {
+        top.directory = true;
+        top.state = Node::Listed;
+        connect(crawler, &DirectoryCrawler::listed, this, &FileTreeModel::applyListings);
+        connect(crawler, &DirectoryCrawler::finished, this, [this](bool cancelled) {
+            if (!cancelled) return;
+            // Let the view ask again the next time one of them is expanded
+            for (Node *node : std::as_const(listing)) {
+                if (node->state == Node::Listing) {
+                    node->state = Node::Unlisted;
+                }
+                node->changedWhileListing = false;
+            }
+            listing.clear();
+        });
+        connect(watcher, &TreeWatcher::changed, this, &FileTreeModel::applyChanges);
+        connect(watcher, &TreeWatcher::directoryDirty, this, &FileTreeModel::relist);
+        connect(watcher, &TreeWatcher::overflowed, this, &FileTreeModel::refresh);
+    }
+
+    void setRootPath(const QString &path, const std::shared_ptr<const IgnoreMatcher> &ignore) {
+        beginResetModel();
+        crawler->cancel();
+        watcher->clear();
+        crawler->setIgnoreMatcher(ignore);
+        matcher = ignore;
+        listing.clear();
+        root = path;
+        top.children.clear();
+        if (!path.isEmpty()) {
+            auto project = std::make_unique<Node>();
+            project->name = QDir(path).dirName();
+            project->directory = true;
+            project->parent = &top;
+            top.children.push_back(std::move(project));
+        }
+        endResetModel();
+    }
+
+    using QObject::parent;
+
+    QString rootPath() const {
+        return root;
+    }
+
+    // Entries the new rules hide or reveal change on the next refresh()
+    void setIgnoreMatcher(const std::shared_ptr<const IgnoreMatcher> &ignore) {
+        crawler->setIgnoreMatcher(ignore);
+        matcher = ignore;
+    }
+
+    QModelIndex projectIndex() const {
+        return top.children.empty() ? QModelIndex() : createIndex(0, 0, top.children.front().get());
+    }
+
+    QString filePath(const QModelIndex &index) const {
+        const Node *node = nodeFor(index);
+        if (node == &top) return QString();
+        QStringList names;
+        for (; node->parent != &top; node = node->parent) {
+            names.prepend(node->name);
+        }
+        return names.isEmpty() ? root : root + "/" + names.join(QLatin1Char('/'));
+    }
+
+    // Invalid when the path is outside the project or not loaded yet
+    QModelIndex index(const QString &path) const {
+        if (top.children.empty()) return QModelIndex();
+        const Node *node = find(path);
+        return node ? createIndex(node->row, 0, const_cast<Node *>(node)) : QModelIndex();
+    }
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override {
+        const Node *node = nodeFor(parent);
+        if (column != 0 || row < 0 || row >= int(node->children.size())) return QModelIndex();
+        return createIndex(row, 0, node->children[row].get());
+    }
+
+    QModelIndex parent(const QModelIndex &child) const override {
+        const Node *node = nodeFor(child);
+        if (node == &top || node->parent == &top) return QModelIndex();
+        return createIndex(node->parent->row, 0, node->parent);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.column() > 0 ? 0 : int(nodeFor(parent)->children.size());
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override {
+        Q_UNUSED(parent);
+        return 1;
+    }
+
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override {
+        const Node *node = nodeFor(parent);
+        return node->state == Node::Listed ? !node->children.empty() : node->directory;
+    }
+
+    bool canFetchMore(const QModelIndex &parent) const override {
+        const Node *node = nodeFor(parent);
+        return node != &top && node->directory && node->state == Node::Unlisted;
+    }
+
+    void fetchMore(const QModelIndex &parent) override {
+        Node *node = nodeFor(parent);
+        if (node == &top || !node->directory || node->state != Node::Unlisted) return;
+        const QString path = filePath(parent);
+        node->state = Node::Listing;
+        listing.insert(path, node);
+        // Watch first so nothing created during the listing is missed
+        watcher->watch(path);
+        crawler->list(path);
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override {
+        if (!index.isValid()) return QVariant();
+        const Node *node = nodeFor(index);
+        switch (role) {
+        case Qt::DisplayRole:
+            return node->name;
+        case Qt::DecorationRole:
+            return node->directory ? QApplication::style()->standardIcon(QStyle::SP_DirIcon) : fileIcon(node->name);
+        case Qt::UserRole:
+            return filePath(index);
+        }
+        return QVariant();
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override {
+        if (section == 0 && orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+            return QStringLiteral("Explorer");
+        }
+        return QVariant();
+    }
+
+    Qt::ItemFlags flags(const QModelIndex &index) const override {
+        if (!index.isValid()) return Qt::NoItemFlags;
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    }
+
+    // Keeps an already listed parent in step with a change made on disk.
+    // Unlisted parents pick the change up when they are listed.
+    void insertPath(const QString &path, bool directory) {
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        Node *parent = find(path.left(slash));
+        if (!parent || parent->state != Node::Listed) return;
+        CrawlEntry entry{path.mid(slash + 1), directory};
+        if (isIgnored(path, directory)) return;
+        const int row = position(parent, entry);
+        if (row < int(parent->children.size()) && parent->children[row]->name == entry.name
+            && parent->children[row]->directory == entry.directory) return;
+        insertNodes(parent, row, {entry});
+    }
+
+    void removePath(const QString &path) {
+        Node *node = find(path);
+        if (!node || node->parent == &top) return;
+        removeNodes(node->parent, node->row, 1);
+    }
+
+    // The row is moved rather than recreated, so a renamed folder keeps its
+    // children, its expansion and any selection inside it
+    void renamePath(const QString &from, const QString &to, bool directory) {
+        Node *node = find(from);
+        const int slash = to.lastIndexOf(QLatin1Char('/'));
+        Node *target = find(to.left(slash));
+        if (!node || node->parent == &top || node->directory != directory
+            || !target || target->state != Node::Listed || isIgnored(to, directory)) {
+            removePath(from);
+            insertPath(to, directory);
+            return;
+        }
+        const QString name = to.mid(slash + 1);
+        // Whatever the rename replaced goes first
+        for (const auto &child : target->children) {
+            if (child.get() != node && child->name == name) {
+                removeNodes(target, child->row, 1);
+                break;
+            }
+        }
+
+        Node *source = node->parent;
+        const int row = node->row;
+        const int destination = position(target, CrawlEntry{name, directory});
+        forget(node);
+        if (source == target && (destination == row || destination == row + 1)) {
+            node->name = name;
+        } else {
+            beginMoveRows(indexFor(source), row, row, indexFor(target), destination);
+            std::unique_ptr<Node> owned = std::move(source->children[row]);
+            source->children.erase(source->children.begin() + row);
+            const int inserted = source == target && destination > row ? destination - 1 : destination;
+            owned->name = name;
+            owned->parent = target;
+            target->children.insert(target->children.begin() + inserted, std::move(owned));
+            if (source == target) {
+                renumber(source, qMin(row, inserted));
+            } else {
+                renumber(source, row);
+                renumber(target, inserted);
+            }
+            endMoveRows();
+        }
+        const QModelIndex index = indexFor(node);
+        emit dataChanged(index, index);
+
+        if (directory) {
+            // Paths below it changed; inotify has already followed the move
+            watcher->unwatch(from);
+            QVector<QPair<QString, Node *>> folders;
+            collectListed(node, to, folders);
+            for (const auto &folder : std::as_const(folders)) {
+                watcher->watch(folder.first);
+            }
+        }
+    }
+
+    // Lists a folder again and merges the result into its rows
+    void relist(const QString &path) {
+        Node *node = find(path);
+        if (!node) return;
+        if (listing.contains(path)) {
+            node->changedWhileListing = true;
+            return;
+        }
+        if (node->state != Node::Listed) return;
+        listing.insert(path, node);
+        crawler->list(path);
+    }
+
+    // The .gitignore in folder changed: its rules are read again and the
+    // folder and the listed folders below it are listed again
+    void reloadIgnoreRules(const QString &folder) {
+        if (!matcher) return;
+        matcher->invalidate(matcher->relativePath(folder));
+        Node *node = find(folder);
+        if (!node) return;
+        QVector<QPair<QString, Node *>> folders;
+        collectListed(node, folder, folders);
+        for (const auto &listed : std::as_const(folders)) {
+            relist(listed.first);
+        }
+    }
+
+    // Lists every folder that has been listed before, e.g. after the
+    // watcher lost events
+    void refresh() {
+        if (top.children.empty()) return;
+        QVector<QPair<QString, Node *>> folders;
+        collectListed(top.children.front().get(), root, folders);
+        for (const auto &folder : std::as_const(folders)) {
+            if (listing.contains(folder.first)) continue;
+            listing.insert(folder.first, folder.second);
+            crawler->list(folder.first);
+        }
+    }
+
+private:
+    struct Node {
+        enum State { Unlisted, Listing, Listed };
+
+        QString name;
+        Node *parent = nullptr;
+        int row = 0;
+        bool directory = false;
+        State state = Unlisted;
+        // The listing in flight may predate a change the watcher reported
+        bool changedWhileListing = false;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    Node *nodeFor(const QModelIndex &index) const {
+        return index.isValid() ? static_cast<Node *>(index.internalPointer()) : const_cast<Node *>(&top);
+    }
+
+    QModelIndex indexFor(Node *node) const {
+        return node == &top ? QModelIndex() : createIndex(node->row, 0, node);
+    }
+
+    Node *find(const QString &path) const {
+        if (top.children.empty()) return nullptr;
+        Node *node = top.children.front().get();
+        if (path == root) return node;
+        if (!path.startsWith(root + "/")) return nullptr;
+        const QStringList names = path.mid(root.size() + 1).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+        for (const QString &name : names) {
+            const auto it = std::find_if(node->children.begin(), node->children.end(),
+                                         [&name](const std::unique_ptr<Node> &child) { return child->name == name; });
+            if (it == node->children.end()) return nullptr;
+            node = it->get();
+        }
+        return node;
+    }
+
+    static std::unique_ptr<Node> makeNode(Node *parent, const CrawlEntry &entry) {
+        auto node = std::make_unique<Node>();
+        node->name = entry.name;
+        node->directory = entry.directory;
+        node->parent = parent;
+        return node;
+    }
+
+    static void renumber(Node *parent, int from) {
+        for (int i = from; i < int(parent->children.size()); ++i) {
+            parent->children[i]->row = i;
+        }
+    }
+
+    void collectListed(Node *node, const QString &path, QVector<QPair<QString, Node *>> &folders) const {
+        if (!node->directory || node->state != Node::Listed) return;
+        folders.append(qMakePair(path, node));
+        for (const auto &child : node->children) {
+            collectListed(child.get(), path + QLatin1Char('/') + child->name, folders);
+        }
+    }
+
+    bool isIgnored(const QString &path, bool directory) const {
+        if (!matcher) return false;
+        const int slash = path.lastIndexOf(QLatin1Char('/'));
+        return matcher->scope(matcher->relativePath(path.left(slash))).ignores(path.mid(slash + 1), directory);
+    }
+
+    // Where entry belongs among parent's children
+    static int position(const Node *parent, const CrawlEntry &entry) {
+        const auto it = std::lower_bound(parent->children.begin(), parent->children.end(), entry,
+            [](const std::unique_ptr<Node> &node, const CrawlEntry &entry) {
+                return entryBefore(node->directory, node->name, entry.directory, entry.name);
+            });
+        return int(it - parent->children.begin());
+    }
+
+    void insertNodes(Node *parent, int row, const QVector<CrawlEntry> &entries) {
+        beginInsertRows(indexFor(parent), row, row + entries.size() - 1);
+        std::vector<std::unique_ptr<Node>> nodes;
+        nodes.reserve(entries.size());
+        for (const CrawlEntry &entry : entries) {
+            nodes.push_back(makeNode(parent, entry));
+        }
+        parent->children.insert(parent->children.begin() + row,
+                                std::make_move_iterator(nodes.begin()), std::make_move_iterator(nodes.end()));
+        renumber(parent, row);
+        endInsertRows();
+    }
+
+    void removeNodes(Node *parent, int row, int count) {
+        for (int i = row; i < row + count; ++i) {
+            Node *node = parent->children[i].get();
+            if (node->directory && node->state != Node::Unlisted) {
+                watcher->unwatch(filePath(indexFor(node)));
+            }
+            forget(node);
+        }
+        beginRemoveRows(indexFor(parent), row, row + count - 1);
+        parent->children.erase(parent->children.begin() + row, parent->children.begin() + row + count);
+        renumber(parent, row);
+        endRemoveRows();
+    }
+
+    // Both sides are in explorer order, so one pass pairs every entry with
+    // its row. Unchanged rows are left alone and each run of added or removed
+    // entries is a single insert or remove.
+    void merge(Node *node, const QVector<CrawlEntry> &entries) {
+        int row = 0;
+        int i = 0;
+        const auto before = [](const Node *child, const CrawlEntry &entry) {
+            return entryBefore(child->directory, child->name, entry.directory, entry.name);
+        };
+        const auto after = [](const Node *child, const CrawlEntry &entry) {
+            return entryBefore(entry.directory, entry.name, child->directory, child->name);
+        };
+        while (row < int(node->children.size()) || i < entries.size()) {
+            const int rows = int(node->children.size());
+            if (row < rows && (i == entries.size() || before(node->children[row].get(), entries.at(i)))) {
+                int end = row + 1;
+                while (end < rows && (i == entries.size() || before(node->children[end].get(), entries.at(i)))) {
+                    ++end;
+                }
+                removeNodes(node, row, end - row);
+            } else if (row == rows || after(node->children[row].get(), entries.at(i))) {
+                int end = i + 1;
+                while (end < entries.size() && (row == rows || after(node->children[row].get(), entries.at(end)))) {
+                    ++end;
+                }
+                insertNodes(node, row, entries.mid(i, end - i));
+                row += end - i;
+                i = end;
+            } else {
+                ++row;
+                ++i;
+            }
+        }
+    }
+
+    // A listing that is still in flight was read before this change, so the
+    // folder is listed again once it arrives
+    void noteChange(const QString &path) {
+        const QString folder = path.left(path.lastIndexOf(QLatin1Char('/')));
+        if (listing.contains(folder)) {
+            listing.value(folder)->changedWhileListing = true;
+        }
+    }
+
+    void applyChanges(const QVector<TreeChange> &changes) {
+        for (const TreeChange &change : changes) {
+            noteChange(change.path);
+            if (change.kind == TreeChange::Renamed) {
+                noteChange(change.to);
+            }
+            switch (change.kind) {
+            case TreeChange::Created:
+                insertPath(change.path, change.directory);
+                break;
+            case TreeChange::Removed:
+                removePath(change.path);
+                break;
+            case TreeChange::Renamed:
+                renamePath(change.path, change.to, change.directory);
+                break;
+            }
+        }
+    }
+
+    // Drops pending listings for a subtree that is about to be deleted or
+    // moved; a folder that was waiting for its first listing can be fetched again
+    void forget(Node *node) {
+        for (auto it = listing.begin(); it != listing.end();) {
+            Node *pending = it.value();
+            while (pending && pending != node) pending = pending->parent;
+            if (!pending) {
+                ++it;
+                continue;
+            }
+            if (it.value()->state == Node::Listing) {
+                it.value()->state = Node::Unlisted;
+            }
+            it.value()->changedWhileListing = false;
+            it = listing.erase(it);
+        }
+    }
+
+    void applyListings(const QVector<CrawlListing> &listings) {
+        for (const CrawlListing &result : listings) {
+            Node *node = listing.take(result.path);
+            if (!node) continue;
+            if (node->state == Node::Listed) {
+                // A folder that vanished is removed through its parent
+                if (result.ok) {
+                    merge(node, result.entries);
+                }
+            } else {
+                node->state = Node::Listed;
+                if (result.entries.isEmpty()) {
+                    // Drops the expand arrow
+                    const QModelIndex parent = indexFor(node);
+                    emit dataChanged(parent, parent);
+                } else {
+                    insertNodes(node, 0, result.entries);
+                }
+            }
+            if (node->changedWhileListing) {
+                node->changedWhileListing = false;
+                relist(result.path);
+            }
+        }
+    }
+
+    DirectoryCrawler *crawler;
+    TreeWatcher *watcher;
+    std::shared_ptr<const IgnoreMatcher> matcher;
+    QString root;
+    Node top;
+    QHash<QString, Node *> listing;
+};
+
+// Web file types served by the preview server, sorted by extension so the
+// lookup can binary search it. JavaScript is text/javascript whatever the
+// extension, which is what module scripts require.
+struct MimeEntry {
+    const char *extension;
+    const char *type;
+    bool compressible;
+};
+
+static constexpr MimeEntry MimeTable[] = {
+    {"aac", "audio/aac", false},
+    {"apng", "image/apng", false},
+    {"avif", "image/avif", false},
+    {"bmp", "image/bmp", true},
+    {"cjs", "text/javascript; charset=utf-8", true},
+    {"css", "text/css; charset=utf-8", true},
+    {"csv", "text/csv; charset=utf-8", true},
+    {"eot", "application/vnd.ms-fontobject", true},
+    {"flac", "audio/flac", false},
+    {"gif", "image/gif", false},
+    {"glb", "model/gltf-binary", false},
+    {"gltf", "model/gltf+json", true},
+    {"htm", "text/html; charset=utf-8", true},
+    {"html", "text/html; charset=utf-8", true},
+    {"ico", "image/x-icon", true},
+    {"jpeg", "image/jpeg", false},
+    {"jpg", "image/jpeg", false},
+    {"js", "text/javascript; charset=utf-8", true},
+    {"json", "application/json; charset=utf-8", true},
+    {"jsonld", "application/ld+json", true},
+    {"m4a", "audio/mp4", false},
+    {"map", "application/json; charset=utf-8", true},
+    {"md", "text/markdown; charset=utf-8", true},
+    {"mjs", "text/javascript; charset=utf-8", true},
+    {"mp3", "audio/mpeg", false},
+    {"mp4", "video/mp4", false},
+    {"oga", "audio/ogg", false},
+    {"ogg", "audio/ogg", false},
+    {"ogv", "video/ogg", false},
+    {"otf", "font/otf", true},
+    {"pdf", "application/pdf", false},
+    {"php", "text/html; charset=utf-8", true},
+    {"png", "image/png", false},
+    {"svg", "image/svg+xml", true},
+    {"ttf", "font/ttf", true},
+    {"txt", "text/plain; charset=utf-8", true},
+    {"vtt", "text/vtt; charset=utf-8", true},
+    {"wasm", "application/wasm", true},
+    {"wav", "audio/wav", false},
+    {"weba", "audio/webm", false},
+    {"webm", "video/webm", false},
+    {"webmanifest", "application/manifest+json", true},
+    {"webp", "image/webp", false},
+    {"woff", "font/woff", false},
+    {"woff2", "font/woff2", false},
+    {"xht", "application/xhtml+xml", true},
+    {"xhtml", "application/xhtml+xml", true},
+    {"xml", "application/xml; charset=utf-8", true},
+    {"zip", "application/zip", false},
+};
+
+static constexpr int MimeTableSize = int(sizeof(MimeTable) / sizeof(MimeTable[0]));
+
+static constexpr int compareExtensions(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return int(static_cast<unsigned char>(*a)) - int(static_cast<unsigned char>(*b));
+}
+
+static constexpr bool mimeTableSorted() {
+    for (int i = 1; i < MimeTableSize; ++i) {
+        if (compareExtensions(MimeTable[i - 1].extension, MimeTable[i].extension) >= 0) return false;
+    }
+    return true;
+}
+
+static_assert(mimeTableSorted(), "MimeTable must stay sorted by extension");
+
+// Content type of a file with its header lines built once per type, so
+// serving a file only has to format Content-Length
+struct FileType {
+    QByteArray type;
+    QByteArray header;
+    bool compressible;
+};
+
+static const FileType &fileTypeFor(const QString &path) {
+    static const QVector<FileType> types = []() {
+        QVector<FileType> result;
+        auto add = [&result](const QByteArray &type, bool compressible) {
+            result.append(FileType{type, "Content-Type: " + type + "\r\nX-Content-Type-Options: nosniff\r\n", compressible});
+        };
+        for (const MimeEntry &entry : MimeTable) {
+            add(entry.type, entry.compressible);
+        }
+        add("application/octet-stream", false);
+        return result;
+    }();
+
+    const qsizetype dot = path.lastIndexOf(QLatin1Char('.'));
+    const qsizetype length = path.size() - dot - 1;
+    if (dot <= path.lastIndexOf(QLatin1Char('/')) || length <= 0 || length > 15) {
+        return types[MimeTableSize];
+    }
+    char extension[16] = {};
+    for (qsizetype i = 0; i < length; ++i) {
+        const char16_t c = path.at(dot + 1 + i).toLower().unicode();
+        if (c > 127) return types[MimeTableSize];
+        extension[i] = char(c);
+    }
+
+    int low = 0;
+    int high = MimeTableSize;
+    while (low < high) {
+        const int middle = (low + high) / 2;
+        const int order = compareExtensions(MimeTable[middle].extension, extension);
+        if (order == 0) return types[middle];
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return types[MimeTableSize];
+}
+
+// Identity of a file on disk, taken with a single stat() where available.
+// Size, modification time and inode together give a strong validator that
+// changes on every rewrite, including atomic replace-by-rename.
+struct FileStamp {
+    bool exists = false;
+    bool directory = false;
+    qint64 size = 0;
+    qint64 modified = 0;
+    quint64 inode = 0;
+
+    QByteArray etag() const {
+        return '"' + QByteArray::number(inode, 16) + '-' + QByteArray::number(size, 16) + '-'
+               + QByteArray::number(modified, 16) + '"';
+    }
+};
+
+static FileStamp fileStamp(const QString &path) {
+    FileStamp stamp;
+#ifdef Q_OS_UNIX
+    struct stat info;
+    if (::stat(QFile::encodeName(path).constData(), &info) != 0) return stamp;
+#ifdef Q_OS_DARWIN
+    const struct timespec &mtime = info.st_mtimespec;
+#else
+    const struct timespec &mtime = info.st_mtim;
+#endif
+    stamp.exists = true;
+    stamp.directory = S_ISDIR(info.st_mode);
+    stamp.size = info.st_size;
+    stamp.modified = qint64(mtime.tv_sec) * 1000 + mtime.tv_nsec / 1000000;
+    stamp.inode = info.st_ino;
+#else
+    const QFileInfo info(path);
+    if (!info.exists()) return stamp;
+    stamp.exists = true;
+    stamp.directory = info.isDir();
+    stamp.size = info.size();
+    stamp.modified = info.lastModified().toMSecsSinceEpoch();
+#endif
+    return stamp;
+}
+
+static QByteArray httpDate(qint64 msecs) {
+    const QDateTime time = QDateTime::fromMSecsSinceEpoch(msecs).toUTC();
+    return QLocale::c().toString(time, "ddd, dd MMM yyyy hh:mm:ss 'GMT'").toLatin1();
+}
+
+static QDateTime parseHttpDate(const QByteArray &value) {
+    const QDateTime parsed = QLocale::c().toDateTime(QString::fromLatin1(value.trimmed()),
+                                                     "ddd, dd MMM yyyy hh:mm:ss 'GMT'");
+    return parsed.isValid() ? QDateTime(parsed.date(), parsed.time(), QTimeZone::utc()) : QDateTime();
+}
+
+static quint32 crc32(const QByteArray &data) {
+    static const QVector<quint32> table = []() {
+        QVector<quint32> result(256);
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            result[int(i)] = value;
+        }
+        return result;
+    }();
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = table[int((crc ^ quint8(byte)) & 0xFF)] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// qCompress produces a 4-byte length followed by a zlib stream (2-byte header,
+// raw deflate data, 4-byte Adler-32). gzip wraps the same deflate data in its
+// own 10-byte header and a CRC-32/length trailer.
+static QByteArray gzipCompress(const QByteArray &data) {
+    const QByteArray zlib = qCompress(data, 6);
+    if (zlib.size() < 10) return QByteArray();
+
+    QByteArray gzip("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+    gzip.append(zlib.constData() + 6, zlib.size() - 10);
+    const quint32 trailer[2] = {crc32(data), quint32(data.size())};
+    for (quint32 value : trailer) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            gzip.append(char((value >> shift) & 0xFF));
+        }
+    }
+    return gzip;
+}
+
+// Live reload: served HTML pulls in a small client script that listens on a
+// Server-Sent Events stream. Each event carries a JSON array of changed URL
+// paths. If only stylesheets changed they are swapped in place, otherwise
+// the page reloads.
+static const char LiveReloadEventsPath[] = "/__webide/livereload";
+static const char LiveReloadScriptPath[] = "/__webide/livereload.js";
+
+static QByteArray liveReloadScript() {
+    return QByteArrayLiteral(
+        "(function () {\n"
+        "  var source = new EventSource('/__webide/livereload');\n"
+        "  source.onmessage = function (event) {\n"
+        "    var paths = JSON.parse(event.data);\n"
+        "    var cssOnly = paths.every(function (p) { return /\\.css$/i.test(p); });\n"
+        "    if (!cssOnly) { location.reload(); return; }\n"
+        "    var links = Array.prototype.filter.call(document.querySelectorAll('link[rel=\"stylesheet\"]'),\n"
+        "      function (link) { return new URL(link.href).origin === location.origin; });\n"
+        "    var matched = links.filter(function (link) {\n"
+        "      return paths.indexOf(new URL(link.href).pathname) >= 0;\n"
+        "    });\n"
+        "    // An @import-ed sheet changed: refresh every local stylesheet\n"
+        "    (matched.length ? matched : links).forEach(function (link) {\n"
+        "      var url = new URL(link.href);\n"
+        "      url.searchParams.set('livereload', Date.now());\n"
+        "      link.href = url.href;\n"
+        "    });\n"
+        "  };\n"
+        "})();\n");
+}
+
+// Pages the live reload script goes into
+static bool isHtmlType(const QByteArray &type) {
+    return type.startsWith("text/html") || type == "application/xhtml+xml";
+}
+
+static QByteArray liveReloadTag() {
+    return "<script src=\"" + QByteArray(LiveReloadScriptPath) + "\"></script>";
+}
+
+static QByteArray injectLiveReload(const QByteArray &html) {
+    const QByteArray tag = liveReloadTag();
+    const qsizetype body = html.toLower().lastIndexOf("</body>");
+    if (body < 0) return html + tag;
+    QByteArray result = html;
+    return result.insert(body, tag);
+}
+
+// Where injectLiveReload puts the tag in a file too large to read whole:
+// before the last </body>, looked for in the file's tail
+static qint64 liveReloadOffset(QFile &file, qint64 size) {
+    const qint64 tail = qMin<qint64>(size, 64 * 1024);
+    if (!file.seek(size - tail)) return size;
+    const qsizetype body = file.read(tail).toLower().lastIndexOf("</body>");
+    return body < 0 ? size : size - tail + body;
+}
+
+// One encoding of a cached file with its header block prebuilt. validators
+// holds the lines a 304 repeats (ETag, Last-Modified, Cache-Control, Vary);
+// headers adds Content-Type, Content-Encoding and Content-Length to them.
+struct CachedBody {
+    QByteArray data;
+    QByteArray etag;
+    QByteArray validators;
+    QByteArray headers;
+};
+
+// A small file held by the asset cache. gzip is filled from a .gz sibling
+// or compressed here; brotli only ever comes from a .br sibling.
+struct CachedAsset {
+    static constexpr qint64 CompressMinBytes = 1024;
+
+    CachedBody identity;
+    CachedBody gzip;
+    CachedBody brotli;
+    QByteArray contentType;
+    QByteArray sourceETag;
+    QStringList sources;
+    qint64 modified = 0;
+
+    qint64 cost() const {
+        qint64 total = 0;
+        for (const CachedBody *body : {&identity, &gzip, &brotli}) {
+            total += body->data.size() + body->headers.size();
+        }
+        return total;
+    }
+};
+
+static CachedBody makeCachedBody(const QByteArray &data, const QByteArray &etag,
+                                 const QByteArray &entityHeaders, const QByteArray &validators) {
+    CachedBody body;
+    body.data = data;
+    body.etag = etag;
+    body.validators = "ETag: " + etag + "\r\n" + validators;
+    body.headers = entityHeaders + "Content-Length: " + QByteArray::number(data.size()) + "\r\n" + body.validators;
+    return body;
+}
+
+// Reads a file plus any precompressed siblings into a cache entry. Returns
+// null when the file cannot be read in full, e.g. while it is being written.
+// HTML gets the live reload script, and then its siblings no longer match it.
+static std::shared_ptr<CachedAsset> loadAsset(const QString &path, const FileStamp &stamp,
+                                              const QByteArray &cacheControl, bool liveReload) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return nullptr;
+    QByteArray data = file.readAll();
+    if (data.size() != stamp.size) return nullptr;
+
+    const FileType &fileType = fileTypeFor(path);
+    const bool inject = liveReload && isHtmlType(fileType.type);
+    if (inject) {
+        data = injectLiveReload(data);
+    }
+    const bool compressible = fileType.compressible;
+    const QByteArray &contentType = fileType.header;
+    QByteArray validators = "Last-Modified: " + httpDate(stamp.modified) + "\r\n";
+    if (!cacheControl.isEmpty()) {
+        validators += "Cache-Control: " + cacheControl + "\r\n";
+    }
+    if (compressible) {
+        validators += "Vary: Accept-Encoding\r\n";
+    }
+
+    auto asset = std::make_shared<CachedAsset>();
+    asset->contentType = fileType.type;
+    asset->sourceETag = stamp.etag();
+    asset->modified = stamp.modified;
+    asset->sources.append(path);
+    QByteArray etag = asset->sourceETag;
+    if (inject) {
+        etag.insert(etag.size() - 1, "-lr");
+    }
+    asset->identity = makeCachedBody(data, etag, contentType + "Accept-Ranges: bytes\r\n", validators);
+    if (!compressible) return asset;
+
+    const struct { const char *suffix; const char *encoding; CachedBody *body; } siblings[] = {
+        {".br", "br", &asset->brotli},
+        {".gz", "gzip", &asset->gzip},
+    };
+    for (const auto &sibling : siblings) {
+        const QString siblingPath = path + QLatin1String(sibling.suffix);
+        const FileStamp siblingStamp = inject ? FileStamp() : fileStamp(siblingPath);
+        QFile siblingFile(siblingPath);
+        if (!siblingStamp.exists || siblingStamp.directory || !siblingFile.open(QIODevice::ReadOnly)) continue;
+        *sibling.body = makeCachedBody(siblingFile.readAll(), siblingStamp.etag(),
+                                       contentType + "Content-Encoding: " + sibling.encoding + "\r\n", validators);
+        asset->sources.append(siblingPath);
+    }
+
+    if (asset->gzip.data.isEmpty() && data.size() >= CachedAsset::CompressMinBytes) {
+        const QByteArray compressed = gzipCompress(data);
+        if (!compressed.isEmpty() && compressed.size() < data.size()) {
+            QByteArray etag = asset->identity.etag;
+            etag.insert(etag.size() - 1, "-gz");
+            asset->gzip = makeCachedBody(compressed, etag, contentType + "Content-Encoding: gzip\r\n", validators);
+        }
+    }
+    return asset;
+}
+
+// Memory-bounded LRU of small file bodies served by the preview server. It is
+// shared by all worker threads. Every file an entry was read from is watched,
+// and a change on disk drops exactly that entry. Watching happens on the
+// cache's own (GUI) thread, so workers queue their watch requests to it.
+class AssetCache : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 MaxEntryBytes = 2 * 1024 * 1024;
+
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        qint64 bytes = 0;
+        int entries = 0;
+    };
+
+    AssetCache(qint64 capacity, QObject *parent = nullptr) : QObject(parent), capacity(capacity) {
+        connect(&watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
+            const QString key = owners.value(path, path);
+            invalidate(key);
+            emit fileChanged(key);
+        });
+    }
+
+    std::shared_ptr<const CachedAsset> find(const QString &path) {
+        QMutexLocker locker(&mutex);
+        auto it = entries.find(path);
+        if (it == entries.end()) {
+            ++stats.misses;
+            return nullptr;
+        }
+        order.splice(order.begin(), order, it->position);
+        ++stats.hits;
+        return it->asset;
+    }
+
+    void insert(const QString &path, const std::shared_ptr<const CachedAsset> &asset) {
+        // Identity body plus its compressed variants
+        const qint64 cost = asset->cost();
+        if (cost > 2 * MaxEntryBytes) return;
+
+        QStringList evicted;
+        {
+            QMutexLocker locker(&mutex);
+            removeLocked(path);
+            order.push_front(path);
+            entries.insert(path, Entry{asset, order.begin(), cost});
+            stats.bytes += cost;
+            while (stats.bytes > capacity && order.size() > 1) {
+                evicted.append(order.back());
+                removeLocked(order.back());
+                ++stats.evictions;
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, path, asset, evicted]() {
+            for (const QString &victim : evicted) {
+                unwatch(victim);
+            }
+            watch(path, asset->sources);
+            // The file may have changed between being read and being watched
+            if (fileStamp(path).etag() != asset->sourceETag) {
+                QMutexLocker locker(&mutex);
+                auto it = entries.find(path);
+                if (it != entries.end() && it->asset == asset) {
+                    removeLocked(path);
+                }
+            }
+        }, Qt::QueuedConnection);
+    }
+
+    void invalidate(const QString &path) {
+        {
+            QMutexLocker locker(&mutex);
+            removeLocked(path);
+        }
+        unwatch(path);
+    }
+
+    void clear() {
+        {
+            QMutexLocker locker(&mutex);
+            entries.clear();
+            order.clear();
+            stats.bytes = 0;
+        }
+        if (!owners.isEmpty()) {
+            watcher.removePaths(owners.keys());
+            owners.clear();
+            watchedFiles.clear();
+        }
+    }
+
+    Stats statistics() const {
+        QMutexLocker locker(&mutex);
+        Stats result = stats;
+        result.entries = entries.size();
+        return result;
+    }
+
+signals:
+    // A watched file changed on disk and its entry was dropped
+    void fileChanged(const QString &path);
+
+private:
+    struct Entry {
+        std::shared_ptr<const CachedAsset> asset;
+        std::list<QString>::iterator position;
+        qint64 cost;
+    };
+
+    void removeLocked(const QString &path) {
+        auto it = entries.find(path);
+        if (it == entries.end()) return;
+        stats.bytes -= it->cost;
+        order.erase(it->position);
+        entries.erase(it);
+    }
+
+    void watch(const QString &path, const QStringList &sources) {
+        unwatch(path);
+        QStringList added;
+        for (const QString &source : sources) {
+            if (!owners.contains(source) && watcher.addPath(source)) {
+                owners.insert(source, path);
+                added.append(source);
+            }
+        }
+        watchedFiles.insert(path, added);
+    }
+
+    void unwatch(const QString &path) {
+        const QStringList sources = watchedFiles.take(path);
+        for (const QString &source : sources) {
+            owners.remove(source);
+        }
+        if (!sources.isEmpty()) {
+            watcher.removePaths(sources);
+        }
+    }
+
+    mutable QMutex mutex;
+    QHash<QString, Entry> entries;
+    std::list<QString> order;
+    Stats stats;
+    qint64 capacity;
+    QFileSystemWatcher watcher;
+    QHash<QString, QString> owners;
+    QHash<QString, QStringList> watchedFiles;
+};
+
+// In-memory map of the served tree: every directory with its sorted child
+// names (directories end in '/') plus the set of files, keyed by path below
+// the root ("/" for the root itself). Workers resolve requests against it
+// without touching the disk. It is built on a pool thread and kept current
+// by a TreeWatcher on every directory, so creates, deletes and renames are
+// rescanned one directory at a time, and every file written below the root
+// is reported for live reload. Hidden entries are not indexed, so they are
+// never served.
+class PathIndex : public QObject {
+    Q_OBJECT
+
+public:
+    enum Kind { Unknown, Missing, File, Directory };
+
+    PathIndex(QObject *parent = nullptr) : QObject(parent) {
+        pool.setMaxThreadCount(1);
+        connect(&watcher, &TreeWatcher::changed, this, [this](const QVector<TreeChange> &changes) {
+            QSet<QString> folders;
+            for (const TreeChange &change : changes) {
+                folders.insert(change.path.left(change.path.lastIndexOf(QLatin1Char('/'))));
+                if (!change.directory) {
+                    emit fileChanged(change.path);
+                }
+                if (change.kind == TreeChange::Renamed) {
+                    folders.insert(change.to.left(change.to.lastIndexOf(QLatin1Char('/'))));
+                    if (!change.directory) {
+                        emit fileChanged(change.to);
+                    }
+                }
+            }
+            for (const QString &folder : std::as_const(folders)) {
+                rescan(folder);
+            }
+        });
+        connect(&watcher, &TreeWatcher::directoryDirty, this, &PathIndex::rescan);
+        connect(&watcher, &TreeWatcher::fileWritten, this, &PathIndex::fileChanged);
+        connect(&watcher, &TreeWatcher::ignoreFileChanged, this, &PathIndex::ignoreFileChanged);
+        connect(&watcher, &TreeWatcher::overflowed, this, [this]() {
+            const QString path = root;
+            setRoot(path, std::shared_ptr<const IgnoreMatcher>(matcher));
+        });
+    }
+
+    ~PathIndex() {
+        generation.ref();
+        pool.waitForDone();
+    }
+
+    void setRoot(const QString &path, const std::shared_ptr<const IgnoreMatcher> &ignore) {
+        const int build = generation.fetchAndAddRelaxed(1) + 1;
+        {
+            QWriteLocker locker(&lock);
+            root = path;
+            matcher = ignore;
+            ready = false;
+            directories.clear();
+            files.clear();
+            pruned.clear();
+        }
+        watcher.clear();
+        if (path.isEmpty()) return;
+
+        PathIndex *index = this;
+        const QAtomicInt *current = &generation;
+        pool.start([index, current, path, ignore, build]() {
+            Snapshot snapshot;
+            scan(path, "/", ignore.get(), snapshot, [current, build]() { return current->loadRelaxed() != build; });
+            // The pool is drained in ~PathIndex, so index outlives this call
+            QMetaObject::invokeMethod(index, [index, path, build, snapshot]() {
+                if (index->generation.loadRelaxed() != build) return;
+                {
+                    QWriteLocker locker(&index->lock);
+                    index->directories = snapshot.directories;
+                    index->files = snapshot.files;
+                    index->pruned = snapshot.pruned;
+                    index->ready = true;
+                }
+                index->watch(snapshot.directories.keys());
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // Unknown until the first scan has finished, and for ignored paths,
+    // which are left to the caller to stat
+    Kind kind(const QString &relative) const {
+        QReadLocker locker(&lock);
+        if (!ready) return Unknown;
+        if (files.contains(relative)) return File;
+        if (directories.contains(relative)) return Directory;
+        return isPruned(relative) ? Unknown : Missing;
+    }
+
+    bool isReady() const {
+        QReadLocker locker(&lock);
+        return ready;
+    }
+
+    // The .gitignore in folder changed: its rules are read again and the
+    // subtree they apply to is scanned again on the pool. The index keeps
+    // answering from the old entries until the new ones are published.
+    void reloadIgnoreRules(const QString &folder) {
+        if (!matcher || (folder != root && !folder.startsWith(root + QLatin1Char('/')))) return;
+        matcher->invalidate(matcher->relativePath(folder));
+        const QString relative = folder == root ? QStringLiteral("/") : folder.mid(root.size());
+        // Ignored and new folders come in through the rescan of their parent
+        if (!ready || !directories.contains(relative)) return;
+        const int build = generation.loadRelaxed();
+
+        PathIndex *index = this;
+        const QAtomicInt *current = &generation;
+        const QString base = root;
+        const std::shared_ptr<const IgnoreMatcher> ignore = matcher;
+        pool.start([index, current, build, base, ignore, folder, relative]() {
+            Snapshot subtree;
+            if (QFileInfo(folder).isDir()) {
+                scan(base, relative, ignore.get(), subtree, [current, build]() { return current->loadRelaxed() != build; });
+            }
+            QMetaObject::invokeMethod(index, [index, build, relative, subtree]() {
+                if (index->generation.loadRelaxed() != build) return;
+                index->replace(relative, subtree);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // Ignored folders are listed from disk when asked for
+    QStringList children(const QString &relative) const {
+        QReadLocker locker(&lock);
+        if (directories.contains(relative) || !isPruned(relative)) {
+            return directories.value(relative);
+        }
+        Snapshot level;
+        scan(root, relative, nullptr, level, []() { return false; }, true);
+        return level.directories.value(relative);
+    }
+
+signals:
+    // A file below the root was written, created, removed or renamed
+    void fileChanged(const QString &path);
+    // The .gitignore in this folder was added, removed or rewritten
+    void ignoreFileChanged(const QString &folder);
+
+private:
+    struct Snapshot {
+        QHash<QString, QStringList> directories;
+        QSet<QString> files;
+        // Ignored entries, which were not scanned further
+        QSet<QString> pruned;
+    };
+
+    // Whether relative or one of its folders was skipped as ignored
+    bool isPruned(const QString &relative) const {
+        if (pruned.isEmpty()) return false;
+        for (int end = relative.size(); end > 0; end = relative.lastIndexOf(QLatin1Char('/'), end - 1)) {
+            if (pruned.contains(relative.left(end))) return true;
+        }
+        return false;
+    }
+
+    static QString childPath(const QString &relative, const QString &name) {
+        return relative == QLatin1String("/") ? relative + name : relative + QLatin1Char('/') + name;
+    }
+
+    // Lists one directory and, unless shallow, everything below it. Symlinked
+    // directories are listed but not entered, so link cycles cannot recurse.
+    // Ignored entries are recorded as pruned and not entered either.
+    static void scan(const QString &root, const QString &relative, const IgnoreMatcher *matcher, Snapshot &snapshot,
+                     const std::function<bool()> &cancelled, bool shallow = false) {
+        if (cancelled()) return;
+        const QDir dir(relative == QLatin1String("/") ? root : root + relative);
+        QStringList names;
+        const QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, QDir::Name | QDir::DirsFirst);
+        IgnoreMatcher::Scope scope;
+        if (matcher) {
+            scope = matcher->scope(relative.mid(1));
+        }
+        for (const QFileInfo &info : entries) {
+            const QString child = childPath(relative, info.fileName());
+            if (matcher && scope.ignores(info.fileName(), info.isDir())) {
+                snapshot.pruned.insert(child);
+                continue;
+            }
+            if (info.isDir()) {
+                names.append(info.fileName() + QLatin1Char('/'));
+                if (!shallow && !info.isSymLink()) {
+                    scan(root, child, matcher, snapshot, cancelled);
+                }
+            } else {
+                names.append(info.fileName());
+                snapshot.files.insert(child);
+            }
+        }
+        snapshot.directories.insert(relative, names);
+    }
+
+    void watch(const QStringList &relativeDirectories) {
+        for (const QString &relative : relativeDirectories) {
+            watcher.watch(relative == QLatin1String("/") ? root : root + relative);
+        }
+    }
+
+    // Something inside one watched directory was created, deleted or
+    // renamed. The folder and any new subtrees are listed on the pool, as an
+    // npm install or a checkout can add thousands of folders at once.
+    void rescan(const QString &path) {
+        if (!ready || (path != root && !path.startsWith(root + QLatin1Char('/')))) return;
+        const QString relative = path == root ? QStringLiteral("/") : path.mid(root.size());
+        const QStringList before = children(relative);
+        const int build = generation.loadRelaxed();
+
+        PathIndex *index = this;
+        const QAtomicInt *current = &generation;
+        const QString base = root;
+        const std::shared_ptr<const IgnoreMatcher> ignore = matcher;
+        pool.start([index, current, build, base, ignore, path, relative, before]() {
+            const auto cancelled = [current, build]() { return current->loadRelaxed() != build; };
+            Snapshot level;
+            if (QFileInfo(path).isDir()) {
+                scan(base, relative, ignore.get(), level, cancelled, true);
+            }
+            const QSet<QString> known(before.cbegin(), before.cend());
+            Snapshot added;
+            for (const QString &name : level.directories.value(relative)) {
+                if (name.endsWith(QLatin1Char('/')) && !known.contains(name)) {
+                    scan(base, childPath(relative, name.chopped(1)), ignore.get(), added, cancelled);
+                }
+            }
+            QMetaObject::invokeMethod(index, [index, build, relative, level, added]() {
+                if (index->generation.loadRelaxed() != build) return;
+                index->publish(relative, level, added);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // Applies a rescan of one folder: entries that left it are dropped with
+    // everything below them, new ones come in with their scanned subtrees
+    void publish(const QString &relative, const Snapshot &level, const Snapshot &added) {
+        const QStringList before = children(relative);
+        const QStringList after = level.directories.value(relative);
+        const QSet<QString> beforeNames(before.cbegin(), before.cend());
+        const QSet<QString> afterNames(after.cbegin(), after.cend());
+
+        QStringList gone;
+        QStringList missed;
+        {
+            QWriteLocker locker(&lock);
+            for (const QString &name : before) {
+                if (afterNames.contains(name)) continue;
+                if (!name.endsWith(QLatin1Char('/'))) {
+                    files.remove(childPath(relative, name));
+                    continue;
+                }
+                const QString directory = childPath(relative, name.chopped(1));
+                const QString prefix = directory + QLatin1Char('/');
+                for (auto it = directories.begin(); it != directories.end();) {
+                    if (it.key() == directory || it.key().startsWith(prefix)) {
+                        gone.append(root + it.key());
+                        it = directories.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                for (auto it = files.begin(); it != files.end();) {
+                    it = it->startsWith(prefix) ? files.erase(it) : std::next(it);
+                }
+            }
+            for (const QString &name : after) {
+                if (beforeNames.contains(name)) continue;
+                if (!name.endsWith(QLatin1Char('/'))) {
+                    files.insert(childPath(relative, name));
+                } else if (!added.directories.contains(childPath(relative, name.chopped(1)))) {
+                    // Was already listed when this rescan was queued, then dropped by another
+                    missed.append(root + childPath(relative, name.chopped(1)));
+                }
+            }
+            if (level.directories.contains(relative)) {
+                directories.insert(relative, after);
+            } else {
+                directories.remove(relative);
+            }
+            for (auto it = added.directories.cbegin(); it != added.directories.cend(); ++it) {
+                directories.insert(it.key(), it.value());
+            }
+            files.unite(added.files);
+            pruned.unite(level.pruned);
+            pruned.unite(added.pruned);
+        }
+
+        for (const QString &directory : std::as_const(gone)) {
+            watcher.unwatch(directory);
+        }
+        watch(level.directories.keys() + added.directories.keys());
+        for (const QString &directory : std::as_const(missed)) {
+            rescan(directory);
+        }
+    }
+
+    // Swaps everything below relative for a fresh scan of it. A folder that
+    // is gone is left to the rescan of its parent.
+    void replace(const QString &relative, const Snapshot &subtree) {
+        if (!subtree.directories.contains(relative)) return;
+        const QString prefix = relative == QLatin1String("/") ? relative : relative + QLatin1Char('/');
+        const auto below = [&relative, &prefix](const QString &path) {
+            return path == relative || path.startsWith(prefix);
+        };
+
+        QStringList gone;
+        {
+            QWriteLocker locker(&lock);
+            for (auto it = directories.begin(); it != directories.end();) {
+                if (!below(it.key())) {
+                    ++it;
+                    continue;
+                }
+                if (!subtree.directories.contains(it.key())) {
+                    gone.append(root + it.key());
+                }
+                it = directories.erase(it);
+            }
+            for (auto it = files.begin(); it != files.end();) {
+                it = below(*it) ? files.erase(it) : std::next(it);
+            }
+            for (auto it = pruned.begin(); it != pruned.end();) {
+                it = below(*it) ? pruned.erase(it) : std::next(it);
+            }
+            for (auto it = subtree.directories.cbegin(); it != subtree.directories.cend(); ++it) {
+                directories.insert(it.key(), it.value());
+            }
+            files.unite(subtree.files);
+            pruned.unite(subtree.pruned);
+        }
+
+        for (const QString &directory : std::as_const(gone)) {
+            watcher.unwatch(directory);
+        }
+        watch(subtree.directories.keys());
+    }
+
+    mutable QReadWriteLock lock;
+    QString root;
+    std::shared_ptr<const IgnoreMatcher> matcher;
+    bool ready = false;
+    QHash<QString, QStringList> directories;
+    QSet<QString> files;
+    QSet<QString> pruned;
+    TreeWatcher watcher;
+    QThreadPool pool;
+    QAtomicInt generation;
+};
+
+// State the preview server shares with its worker threads. The project root
+// is changed from the GUI thread while requests are being served, so it is
+// only ever read through the lock.
+class ServerContext {
+public:
+    ServerContext(AssetCache *assets, PathIndex *paths) : assets(assets), paths(paths) {}
+
+    AssetCache *cache() const { return assets; }
+    PathIndex *index() const { return paths; }
+
+    bool liveReloadEnabled() const { return liveReload.loadRelaxed(); }
+    void setLiveReloadEnabled(bool enabled) { liveReload.storeRelaxed(enabled); }
+
+    bool spaFallbackEnabled() const { return spaFallback.loadRelaxed(); }
+    void setSpaFallbackEnabled(bool enabled) { spaFallback.storeRelaxed(enabled); }
+
+    QString rootPath() const {
+        QReadLocker locker(&lock);
+        return root;
+    }
+
+    void setRootPath(const QString &path) {
+        QWriteLocker locker(&lock);
+        root = path;
+    }
+
+    // Rules are "pattern = value" lines and the first match wins. A pattern
+    // without a slash matches the file name, otherwise the path below the root.
+    void setCacheControlRules(const QStringList &rules) {
+        QVector<CacheControlRule> compiled;
+        for (const QString &rule : rules) {
+            const qsizetype separator = rule.indexOf(QLatin1Char('='));
+            if (separator <= 0) continue;
+            const QString pattern = rule.left(separator).trimmed();
+            compiled.append(CacheControlRule{
+                QRegularExpression(QRegularExpression::wildcardToRegularExpression(pattern)),
+                pattern.contains(QLatin1Char('/')),
+                rule.mid(separator + 1).trimmed().toLatin1()});
+        }
+        QWriteLocker locker(&lock);
+        cacheControlRules = compiled;
+    }
+
+    QByteArray cacheControlFor(const QString &relative) const {
+        const QString path = relative.mid(1);
+        const QString name = relative.mid(relative.lastIndexOf(QLatin1Char('/')) + 1);
+        QReadLocker locker(&lock);
+        for (const CacheControlRule &rule : cacheControlRules) {
+            if (rule.pattern.match(rule.matchPath ? path : name).hasMatch()) {
+                return rule.value;
+            }
+        }
+        return QByteArray();
+    }
+
+private:
+    struct CacheControlRule {
+        QRegularExpression pattern;
+        bool matchPath;
+        QByteArray value;
+    };
+
+    AssetCache *assets;
+    PathIndex *paths;
+    QAtomicInt liveReload = 1;
+    QAtomicInt spaFallback = 0;
+    mutable QReadWriteLock lock;
+    QString root;
+    QVector<CacheControlRule> cacheControlRules;
+};
+
+// One request taken off a connection. Header names are stored lower-cased.
+struct HttpRequest {
+    QByteArray method;
+    QByteArray target;
+    QString path;
+    int minorVersion = 1;
+    bool keepAlive = true;
+    QHash<QByteArray, QByteArray> headers;
+
+    QByteArray header(const QByteArray &name) const { return headers.value(name); }
+    bool isHead() const { return method == "HEAD"; }
+};
+
+// Incremental HTTP/1.x request parser. Bytes are appended as they arrive and
+// complete requests are taken off the front one at a time, so headers split
+// across reads and pipelined requests both work. Request bodies are skipped.
+class HttpRequestParser {
+public:
+    enum Result { NeedMore, Ready, Failed };
+
+    static constexpr int MaxHeaderBytes = 64 * 1024;
+
+    void append(const QByteArray &data) { buffer.append(data); }
+    int errorStatus() const { return error; }
+
+    Result next(HttpRequest &request) {
+        if (error) return Failed;
+        if (bodyRemaining > 0) {
+            const qint64 skip = qMin<qint64>(bodyRemaining, buffer.size());
+            buffer.remove(0, skip);
+            bodyRemaining -= skip;
+            if (bodyRemaining > 0) return NeedMore;
+        }
+        // Clients may send stray blank lines between pipelined requests
+        while (buffer.startsWith("\r\n")) {
+            buffer.remove(0, 2);
+            scanned = 0;
+        }
 
-// Syntax Highlighter for HTML/CSS/JS/PHP
-class CodeHighlighter : public QSyntaxHighlighter {
+        const qsizetype end = buffer.indexOf("\r\n\r\n", qMax<qsizetype>(0, scanned - 3));
+        if (end < 0) {
+            scanned = buffer.size();
+            return buffer.size() > MaxHeaderBytes ? fail(431) : NeedMore;
+        }
+        scanned = 0;
+        if (end > MaxHeaderBytes) return fail(431);
+
+        const QByteArray head = buffer.left(end);
+        buffer.remove(0, end + 4);
+        return parseHead(head, request);
+    }
+
+private:
+    Result fail(int status) {
+        error = status;
+        buffer.clear();
+        return Failed;
+    }
+
+    Result parseHead(const QByteArray &head, HttpRequest &request) {
+        const QList<QByteArray> lines = head.split('\n');
+        const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+        if (requestLine.size() != 3) return fail(400);
+
+        request = HttpRequest();
+        request.method = requestLine[0];
+        request.target = requestLine[1];
+        const QByteArray &version = requestLine[2];
+        if (!version.startsWith("HTTP/")) return fail(400);
+        if (version.size() != 8 || !version.startsWith("HTTP/1.")) return fail(505);
+        request.minorVersion = version.at(7) - '0';
+
+        for (int i = 1; i < lines.size(); ++i) {
+            const QByteArray line = lines[i].trimmed();
+            if (line.isEmpty()) continue;
+            const qsizetype colon = line.indexOf(':');
+            if (colon <= 0) return fail(400);
+            const QByteArray name = line.left(colon).trimmed().toLower();
+            const QByteArray value = line.mid(colon + 1).trimmed();
+            auto it = request.headers.find(name);
+            if (it == request.headers.end()) {
+                request.headers.insert(name, value);
+            } else {
+                it->append(", ").append(value);
+            }
+        }
+
+        if (request.headers.contains("transfer-encoding")) return fail(501);
+        if (request.headers.contains("content-length")) {
+            bool ok = false;
+            bodyRemaining = request.header("content-length").toLongLong(&ok);
+            if (!ok || bodyRemaining < 0) return fail(400);
+        }
+
+        const QByteArray connection = request.header("connection").toLower();
+        request.keepAlive = request.minorVersion >= 1 ? !connection.contains("close")
+                                                      : connection.contains("keep-alive");
+
+        // Accept absolute-form targets from proxies as well as origin-form
+        QByteArray target = request.target;
+        if (!target.startsWith('/')) {
+            const qsizetype scheme = target.indexOf("://");
+            const qsizetype slash = scheme < 0 ? -1 : target.indexOf('/', scheme + 3);
+            target = slash < 0 ? QByteArray("/") : target.mid(slash);
+        }
+        const qsizetype query = target.indexOf('?');
+        request.path = QUrl::fromPercentEncoding(query < 0 ? target : target.left(query));
+        return Ready;
+    }
+
+    QByteArray buffer;
+    qsizetype scanned = 0;
+    qint64 bodyRemaining = 0;
+    int error = 0;
+};
+
+// If-None-Match wins over If-Modified-Since when both are sent (RFC 9110 13.2.2)
+static bool isNotModified(const HttpRequest &request, const QByteArray &etag, qint64 modified) {
+    if (request.headers.contains("if-none-match")) {
+        for (QByteArray tag : request.header("if-none-match").split(',')) {
+            tag = tag.trimmed();
+            if (tag.startsWith("W/")) tag = tag.mid(2);
+            if (tag == "*" || tag == etag) return true;
+        }
+        return false;
+    }
+    if (request.headers.contains("if-modified-since")) {
+        const QDateTime since = parseHttpDate(request.header("if-modified-since"));
+        return since.isValid() && modified / 1000 <= since.toSecsSinceEpoch();
+    }
+    return false;
+}
+
+// True when Accept-Encoding lists the coding, or *, without q=0
+static bool acceptsEncoding(const HttpRequest &request, const char *coding) {
+    for (const QByteArray &item : request.header("accept-encoding").split(',')) {
+        const QList<QByteArray> params = item.split(';');
+        const QByteArray name = params.first().trimmed().toLower();
+        if (name != coding && name != "*") continue;
+        for (int i = 1; i < params.size(); ++i) {
+            const QByteArray param = params[i].trimmed();
+            if (param.startsWith("q=") && param.mid(2).toDouble() <= 0.0) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+struct ByteRange {
+    qint64 first;
+    qint64 last;
+
+    qint64 length() const { return last - first + 1; }
+};
+
+enum class RangeResult { Ignore, Satisfiable, Unsatisfiable };
+
+// Resolves a GET's Range header against a representation of size bytes.
+// Overlapping and adjacent ranges are merged, and the header is ignored
+// (full 200) when it is malformed, asks for too many pieces, or If-Range no
+// longer matches the representation.
+static RangeResult parseRange(const HttpRequest &request, const QByteArray &etag, qint64 modified,
+                              qint64 size, QVector<ByteRange> &ranges) {
+    static constexpr int MaxRanges = 16;
+
+    const QByteArray header = request.header("range").trimmed();
+    if (header.isEmpty() || request.method != "GET" || !header.startsWith("bytes=")) {
+        return RangeResult::Ignore;
+    }
+    if (request.headers.contains("if-range")) {
+        const QByteArray condition = request.header("if-range").trimmed();
+        if (condition.startsWith('"') || condition.startsWith("W/")) {
+            if (condition != etag) return RangeResult::Ignore;
+        } else {
+            const QDateTime date = parseHttpDate(condition);
+            if (!date.isValid() || date.toSecsSinceEpoch() != modified / 1000) return RangeResult::Ignore;
+        }
+    }
+
+    ranges.clear();
+    for (const QByteArray &item : header.mid(6).split(',')) {
+        const QByteArray spec = item.trimmed();
+        const qsizetype dash = spec.indexOf('-');
+        if (dash < 0) return RangeResult::Ignore;
+        const QByteArray start = spec.left(dash).trimmed();
+        const QByteArray end = spec.mid(dash + 1).trimmed();
+        bool ok = false;
+        ByteRange range;
+        if (start.isEmpty()) {
+            const qint64 suffix = end.toLongLong(&ok);
+            if (!ok || suffix < 0) return RangeResult::Ignore;
+            if (suffix == 0 || size == 0) continue;
+            range = ByteRange{qMax<qint64>(0, size - suffix), size - 1};
+        } else {
+            range.first = start.toLongLong(&ok);
+            if (!ok || range.first < 0) return RangeResult::Ignore;
+            range.last = size - 1;
+            if (!end.isEmpty()) {
+                range.last = end.toLongLong(&ok);
+                if (!ok || range.last < range.first) return RangeResult::Ignore;
+            }
+            if (range.first >= size) continue;
+            range.last = qMin(range.last, size - 1);
+        }
+        ranges.append(range);
+    }
+    if (ranges.isEmpty()) return RangeResult::Unsatisfiable;
+
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange &a, const ByteRange &b) { return a.first < b.first; });
+    QVector<ByteRange> merged;
+    for (const ByteRange &range : ranges) {
+        if (!merged.isEmpty() && range.first <= merged.last().last + 1) {
+            merged.last().last = qMax(merged.last().last, range.last);
+        } else {
+            merged.append(range);
+        }
+    }
+    if (merged.size() > MaxRanges) return RangeResult::Ignore;
+    ranges = merged;
+    return RangeResult::Satisfiable;
+}
+
+static QByteArray httpReasonPhrase(int status) {
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 416: return "Range Not Satisfiable";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    case 505: return "HTTP Version Not Supported";
+    default: return "Error";
+    }
+}
+
+// Response body written to a socket a slice at a time. The body is a list of
+// parts, each either literal bytes or a byte range of the open file. Writing
+// stops whenever the socket already holds HighWaterBytes, and resumes from
+// bytesWritten, so memory use does not grow with the file size. On Linux, file
+// ranges go straight from the page cache with sendfile() once Qt's own write
+// buffer has drained. Otherwise they are copied out of a memory map.
+class ResponseStream {
 public:
-    CodeHighlighter(QTextDocument *parent = nullptr) : QSyntaxHighlighter(parent) {
-        setupRules();
-    }
-
-    void setupRules() {
-        HighlightingRule rule;
-
-        // HTML Tags
-        tagFormat.setForeground(QColor(86, 156, 214));
-        tagFormat.setFontWeight(QFont::Bold);
-        rule.pattern = QRegularExpression("<[/?]?\\w+");
-        rule.format = tagFormat;
-        highlightingRules.append(rule);
-
-        rule.pattern = QRegularExpression("/?>");
-        highlightingRules.append(rule);
-
-        // Attributes
-        attributeFormat.setForeground(QColor(156, 220, 254));
-        rule.pattern = QRegularExpression("\\b[A-Za-z-]+(?=\\=)");
-        rule.format = attributeFormat;
-        highlightingRules.append(rule);
-
-        // Strings
-        stringFormat.setForeground(QColor(206, 145, 120));
-        rule.pattern = QRegularExpression("\".*?\"|'.*?'");
-        rule.format = stringFormat;
-        highlightingRules.append(rule);
-
-        // JavaScript Keywords
-        keywordFormat.setForeground(QColor(197, 134, 192));
-        keywordFormat.setFontWeight(QFont::Bold);
-        QStringList keywordPatterns = {
-            "\\bfunction\\b", "\\bvar\\b", "\\blet\\b", "\\bconst\\b",
-            "\\breturn\\b", "\\bif\\b", "\\belse\\b", "\\bfor\\b",
-            "\\bwhile\\b", "\\bswitch\\b", "\\bcase\\b", "\\bbreak\\b",
-            "\\bcontinue\\b", "\\btrue\\b", "\\bfalse\\b", "\\bnull\\b",
-            "\\bundefined\\b", "\\bnew\\b", "\\bthis\\b", "\\bclass\\b"
-        };
-        for (const QString &pattern : keywordPatterns) {
-            rule.pattern = QRegularExpression(pattern);
-            rule.format = keywordFormat;
-            highlightingRules.append(rule);
-        }
-
-        // CSS Properties
-        cssPropertyFormat.setForeground(QColor(156, 220, 254));
-        rule.pattern = QRegularExpression("\\b[a-z-]+(?=\\s*:)");
-        rule.format = cssPropertyFormat;
-        highlightingRules.append(rule);
-
-        // PHP Tags and Keywords
-        phpFormat.setForeground(QColor(197, 134, 192));
-        phpFormat.setFontWeight(QFont::Bold);
-        rule.pattern = QRegularExpression("<\\?php|\\?>");
-        rule.format = phpFormat;
-        highlightingRules.append(rule);
-
-        // Numbers
-        numberFormat.setForeground(QColor(181, 206, 168));
-        rule.pattern = QRegularExpression("\\b[0-9]+\\.?[0-9]*\\b");
-        rule.format = numberFormat;
-        highlightingRules.append(rule);
-
-        // Comments
-        commentFormat.setForeground(QColor(106, 153, 85));
-        commentFormat.setFontItalic(true);
-        rule.pattern = QRegularExpression("//[^\n]*|/\\*.*?\\*/|<!--.*?-->");
-        rule.format = commentFormat;
-        highlightingRules.append(rule);
+    static constexpr qint64 HighWaterBytes = 256 * 1024;
+    static constexpr qint64 ChunkBytes = 64 * 1024;
+
+    explicit ResponseStream(std::unique_ptr<QFile> file) : file(std::move(file)) {}
+
+    void addBytes(const QByteArray &bytes) {
+        if (!bytes.isEmpty()) parts.append(Part{bytes, 0, 0});
     }
 
-protected:
-    void highlightBlock(const QString &text) override {
-        for (const HighlightingRule &rule : highlightingRules) {
-            QRegularExpressionMatchIterator matchIterator = rule.pattern.globalMatch(text);
-            while (matchIterator.hasNext()) {
-                QRegularExpressionMatch match = matchIterator.next();
-                setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+    void addFileRange(qint64 offset, qint64 length) {
+        if (length > 0) parts.append(Part{QByteArray(), offset, length});
+    }
+
+    bool failed() const { return error; }
+
+    // Writes as much as backpressure allows; returns true once everything is queued
+    bool pump(QTcpSocket *socket) {
+        while (current < parts.size()) {
+            if (socket->bytesToWrite() >= HighWaterBytes) return false;
+            Part &part = parts[current];
+            if (!part.bytes.isEmpty()) {
+                socket->write(part.bytes);
+                ++current;
+                continue;
+            }
+            if (part.length == 0) {
+                ++current;
+                continue;
+            }
+#ifdef Q_OS_LINUX
+            if (socket->bytesToWrite() == 0 && useSendfile) {
+                off_t offset = part.offset;
+                const ssize_t sent = ::sendfile(int(socket->socketDescriptor()), file->handle(), &offset,
+                                                size_t(qMin<qint64>(part.length, 16 * ChunkBytes)));
+                if (sent > 0) {
+                    part.offset += sent;
+                    part.length -= sent;
+                    continue;
+                }
+                // Kernel buffer is full: queue one slice below and wait for bytesWritten
+                if (sent < 0 && errno != EAGAIN && errno != EINTR) useSendfile = false;
             }
+#endif
+            const qint64 length = qMin(part.length, ChunkBytes);
+            if (!writeSlice(socket, part.offset, length)) {
+                error = true;
+                return true;
+            }
+            part.offset += length;
+            part.length -= length;
         }
+        return true;
     }
 
 private:
-    struct HighlightingRule {
-        QRegularExpression pattern;
-        QTextCharFormat format;
+    struct Part {
+        QByteArray bytes;
+        qint64 offset;
+        qint64 length;
     };
-    QVector<HighlightingRule> highlightingRules;
-    
-    QTextCharFormat tagFormat;
-    QTextCharFormat attributeFormat;
-    QTextCharFormat stringFormat;
-    QTextCharFormat keywordFormat;
-    QTextCharFormat cssPropertyFormat;
-    QTextCharFormat phpFormat;
-    QTextCharFormat numberFormat;
-    QTextCharFormat commentFormat;
+
+    bool writeSlice(QTcpSocket *socket, qint64 offset, qint64 length) {
+        if (!mapped && !mapFailed) {
+            mapped = file->map(0, file->size());
+            mapFailed = !mapped;
+        }
+        if (mapped && offset + length <= file->size()) {
+            return socket->write(reinterpret_cast<const char*>(mapped + offset), length) == length;
+        }
+        if (!file->seek(offset)) return false;
+        const QByteArray slice = file->read(length);
+        return slice.size() == length && socket->write(slice) == length;
+    }
+
+    std::unique_ptr<QFile> file;
+    QVector<Part> parts;
+    int current = 0;
+    uchar *mapped = nullptr;
+    bool mapFailed = false;
+    bool useSendfile = true;
+    bool error = false;
 };
 
-// Custom Text Editor
-class CodeEditor : public QTextEdit {
+// One client connection inside a server worker thread. Requests are parsed as
+// bytes arrive and answered strictly in order. The socket stays open between
+// requests until the client asks to close it or leaves it idle too long.
+class HttpConnection : public QObject {
     Q_OBJECT
-    
+
 public:
-    CodeEditor(const QString &fileType = "", QWidget *parent = nullptr) : QTextEdit(parent), currentFileType(fileType) {
-        highlighter = new CodeHighlighter(document());
-        applyTheme(true); // Default dark theme
-        setupAutoComplete();
-        
-        connect(this, &QTextEdit::textChanged, this, &CodeEditor::onTextChanged);
+    static constexpr int IdleTimeoutMs = 15000;
+
+    HttpConnection(QTcpSocket *socket, std::shared_ptr<ServerContext> context, QObject *parent)
+        : QObject(parent), socket(socket), context(std::move(context)) {
+        socket->setParent(this);
+        idleTimer.setSingleShot(true);
+        idleTimer.setInterval(IdleTimeoutMs);
+        connect(&idleTimer, &QTimer::timeout, this, &HttpConnection::close);
+        connect(socket, &QTcpSocket::readyRead, this, &HttpConnection::readRequests);
+        connect(socket, &QTcpSocket::bytesWritten, this, [this]() {
+            if (closing || eventStream) return;
+            idleTimer.start();
+            if (stream) pumpStream();
+        });
+        idleTimer.start();
     }
 
-    void applyTheme(bool isDark) {
-        if (isDark) {
-            setStyleSheet(R"(
-                QTextEdit {
-                    background-color: #1e1e1e;
-                    color: #d4d4d4;
-                    border: none;
-                    font-family: 'Consolas', 'Courier New', monospace;
-                    font-size: 14px;
+    // Pushes one event down a live reload stream
+    void sendEvent(const QByteArray &event) {
+        if (!eventStream || closing) return;
+        // A client that stopped reading is not worth buffering for
+        if (socket->bytesToWrite() > ResponseStream::HighWaterBytes) {
+            close();
+            return;
+        }
+        socket->write(event);
+    }
+
+signals:
+    void eventStreamStarted(HttpConnection *connection);
+
+private:
+    void readRequests() {
+        if (closing || eventStream) {
+            socket->readAll();
+            return;
+        }
+        idleTimer.start();
+        parser.append(socket->readAll());
+        processRequests();
+    }
+
+    void processRequests() {
+        HttpRequest request;
+        while (!closing && !stream && !eventStream) {
+            const HttpRequestParser::Result result = parser.next(request);
+            if (result == HttpRequestParser::NeedMore) break;
+            if (result == HttpRequestParser::Failed) {
+                HttpRequest failed;
+                failed.keepAlive = false;
+                sendError(failed, parser.errorStatus());
+                break;
+            }
+            respond(request);
+        }
+    }
+
+    void respond(const HttpRequest &request) {
+        if (request.method != "GET" && request.method != "HEAD") {
+            sendError(request, 405, "Allow: GET, HEAD\r\n");
+            return;
+        }
+        if (request.path == QLatin1String(LiveReloadEventsPath) && !request.isHead()) {
+            startEventStream();
+            return;
+        }
+        if (request.path == QLatin1String(LiveReloadScriptPath)) {
+            const QByteArray script = liveReloadScript();
+            writeHead(request, 200, "Content-Type: text/javascript; charset=utf-8\r\nCache-Control: no-cache\r\n",
+                      script.size());
+            if (!request.isHead()) {
+                socket->write(script);
+            }
+            finishResponse(request);
+            return;
+        }
+
+        QString relative = QDir::cleanPath(request.path);
+        if (!relative.startsWith(QLatin1Char('/')) || relative == "/.." || relative.startsWith("/../")) {
+            sendError(request, 400);
+            return;
+        }
+
+        const QString root = context->rootPath();
+        // Hidden files and folders are not indexed, so never serve them
+        if (root.isEmpty() || relative.contains(QLatin1String("/."))) {
+            sendError(request, 404);
+            return;
+        }
+
+        const PathIndex::Kind kind = resolve(root, relative);
+        if (kind == PathIndex::Directory) {
+            if (!request.path.endsWith(QLatin1Char('/'))) {
+                redirectToDirectory(request);
+                return;
+            }
+            const QString indexPage = (relative == QLatin1String("/") ? QString() : relative) + "/index.html";
+            if (resolve(root, indexPage) != PathIndex::File) {
+                sendDirectoryListing(request, relative);
+                return;
+            }
+            relative = indexPage;
+        } else if (kind == PathIndex::Missing) {
+            // History-API routes: extensionless paths from a browser navigation get the app shell
+            const bool route = !relative.mid(relative.lastIndexOf(QLatin1Char('/')) + 1).contains(QLatin1Char('.'));
+            if (!context->spaFallbackEnabled() || !route || !request.header("accept").contains("text/html")
+                || resolve(root, "/index.html") != PathIndex::File) {
+                sendError(request, 404);
+                return;
+            }
+            relative = QStringLiteral("/index.html");
+        }
+
+        const QString path = root + relative;
+        if (std::shared_ptr<const CachedAsset> asset = context->cache()->find(path)) {
+            sendAsset(request, *asset);
+            return;
+        }
+
+        // A miss reads the file anyway, so this stat is not on the hot path
+        const FileStamp stamp = fileStamp(path);
+        if (!stamp.exists || stamp.directory) {
+            sendError(request, 404);
+            return;
+        }
+        const QByteArray cacheControl = context->cacheControlFor(relative);
+        if (stamp.size > AssetCache::MaxEntryBytes) {
+            streamFile(request, path, stamp, cacheControl);
+            return;
+        }
+
+        std::shared_ptr<CachedAsset> asset = loadAsset(path, stamp, cacheControl, context->liveReloadEnabled());
+        if (!asset) {
+            // Being rewritten right now; stream whatever is there without caching it
+            streamFile(request, path, stamp, cacheControl);
+            return;
+        }
+        context->cache()->insert(path, asset);
+        sendAsset(request, *asset);
+    }
+
+    // Looks a path up in the index, or on disk while the index is still being built
+    PathIndex::Kind resolve(const QString &root, const QString &relative) const {
+        const PathIndex::Kind kind = context->index()->kind(relative);
+        if (kind != PathIndex::Unknown) return kind;
+        const FileStamp stamp = fileStamp(root + relative);
+        if (!stamp.exists) return PathIndex::Missing;
+        return stamp.directory ? PathIndex::Directory : PathIndex::File;
+    }
+
+    // Directory URLs need the trailing slash for their relative links to work
+    void redirectToDirectory(const HttpRequest &request) {
+        const qsizetype query = request.target.indexOf('?');
+        QByteArray location = QUrl::toPercentEncoding(request.path, "/") + '/';
+        if (query >= 0) {
+            location += request.target.mid(query);
+        }
+        writeHead(request, 301, "Location: " + location + "\r\n", 0);
+        finishResponse(request);
+    }
+
+    void sendDirectoryListing(const HttpRequest &request, const QString &relative) {
+        if (!context->index()->isReady()) {
+            sendError(request, 503, "Retry-After: 1\r\n");
+            return;
+        }
+        const QByteArray title = "Index of " + (relative == QLatin1String("/") ? relative : relative + QLatin1Char('/')).toHtmlEscaped().toUtf8();
+        QByteArray html = "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>" + title + "</title>"
+                          "<style>body{font-family:sans-serif;margin:2em}li{line-height:1.6}</style></head>\n"
+                          "<body>\n<h1>" + title + "</h1>\n<ul>\n";
+        if (relative != QLatin1String("/")) {
+            html += "<li><a href=\"../\">../</a></li>\n";
+        }
+        for (const QString &name : context->index()->children(relative)) {
+            html += "<li><a href=\"" + QUrl::toPercentEncoding(name, "/") + "\">" + name.toHtmlEscaped().toUtf8() + "</a></li>\n";
+        }
+        html += "</ul>\n</body></html>\n";
+        if (context->liveReloadEnabled()) {
+            html = injectLiveReload(html);
+        }
+
+        writeHead(request, 200, fileTypeFor("index.html").header + "Cache-Control: no-cache\r\n", html.size());
+        if (!request.isHead()) {
+            socket->write(html);
+        }
+        finishResponse(request);
+    }
+
+    void sendAsset(const HttpRequest &request, const CachedAsset &asset) {
+        // Ranges always address the identity body
+        const bool ranged = request.headers.contains("range");
+        const CachedBody *body = &asset.identity;
+        if (!ranged && !asset.brotli.data.isEmpty() && acceptsEncoding(request, "br")) {
+            body = &asset.brotli;
+        } else if (!ranged && !asset.gzip.data.isEmpty() && acceptsEncoding(request, "gzip")) {
+            body = &asset.gzip;
+        }
+        if (isNotModified(request, body->etag, asset.modified)) {
+            writeHead(request, 304, body->validators);
+            finishResponse(request);
+            return;
+        }
+        const qint64 size = asset.identity.data.size();
+        QVector<ByteRange> ranges;
+        const RangeResult range = ranged ? parseRange(request, asset.identity.etag, asset.modified, size, ranges)
+                                         : RangeResult::Ignore;
+        if (range == RangeResult::Unsatisfiable) {
+            sendError(request, 416, "Content-Range: bytes */" + QByteArray::number(size) + "\r\n");
+            return;
+        }
+        if (range == RangeResult::Satisfiable) {
+            sendRanges(request, ranges, asset.contentType, body->validators, size, asset.identity.data, nullptr);
+            return;
+        }
+        writeHead(request, 200, body->headers);
+        if (!request.isHead()) {
+            socket->write(body->data);
+        }
+        finishResponse(request);
+    }
+
+    // Files too large for the cache are streamed, from a precompressed
+    // sibling when the client accepts one; they are not compressed on the fly.
+    void streamFile(const HttpRequest &request, const QString &path, const FileStamp &stamp, const QByteArray &cacheControl) {
+        const FileType &fileType = fileTypeFor(path);
+        const bool compressible = fileType.compressible;
+        QString servedPath = path;
+        FileStamp served = stamp;
+        QByteArray headers = fileType.header;
+        // HTML gets the live reload tag spliced in, which no sibling or byte
+        // range of the file on disk has
+        const bool inject = context->liveReloadEnabled() && isHtmlType(fileType.type);
+        const bool ranged = !inject && request.headers.contains("range");
+        if (compressible && !ranged && !inject) {
+            const struct { const char *suffix; const char *encoding; } siblings[] = {{".br", "br"}, {".gz", "gzip"}};
+            for (const auto &sibling : siblings) {
+                if (!acceptsEncoding(request, sibling.encoding)) continue;
+                const QString siblingPath = path + QLatin1String(sibling.suffix);
+                const FileStamp siblingStamp = fileStamp(siblingPath);
+                if (siblingStamp.exists && !siblingStamp.directory) {
+                    servedPath = siblingPath;
+                    served = siblingStamp;
+                    headers += "Content-Encoding: " + QByteArray(sibling.encoding) + "\r\n";
+                    break;
                 }
-            )");
+            }
+        }
+
+        QByteArray etag = served.etag();
+        if (inject) {
+            etag.insert(etag.size() - 1, "-lr");
+        }
+        QByteArray validators = "ETag: " + etag + "\r\nLast-Modified: " + httpDate(stamp.modified) + "\r\n";
+        if (!cacheControl.isEmpty()) {
+            validators += "Cache-Control: " + cacheControl + "\r\n";
+        }
+        if (compressible) {
+            validators += "Vary: Accept-Encoding\r\n";
+        }
+        if (isNotModified(request, etag, stamp.modified)) {
+            writeHead(request, 304, validators);
+            finishResponse(request);
+            return;
+        }
+
+        std::unique_ptr<QFile> file(new QFile(servedPath));
+        if (!file->open(QIODevice::ReadOnly)) {
+            sendError(request, 404);
+            return;
+        }
+        const qint64 size = file->size();
+        if (servedPath == path && !inject) {
+            QVector<ByteRange> ranges;
+            const RangeResult range = ranged ? parseRange(request, served.etag(), stamp.modified, size, ranges)
+                                             : RangeResult::Ignore;
+            if (range == RangeResult::Unsatisfiable) {
+                sendError(request, 416, "Content-Range: bytes */" + QByteArray::number(size) + "\r\n");
+                return;
+            }
+            if (range == RangeResult::Satisfiable) {
+                sendRanges(request, ranges, fileType.type, validators, size, QByteArray(), std::move(file));
+                return;
+            }
+            headers += "Accept-Ranges: bytes\r\n";
+        }
+        const QByteArray tag = inject ? liveReloadTag() : QByteArray();
+        const qint64 split = inject ? liveReloadOffset(*file, size) : size;
+        writeHead(request, 200, headers + validators, size + tag.size());
+        if (request.isHead()) {
+            finishResponse(request);
+            return;
+        }
+        stream.reset(new ResponseStream(std::move(file)));
+        stream->addFileRange(0, split);
+        stream->addBytes(tag);
+        stream->addFileRange(split, size - split);
+        streamKeepAlive = request.keepAlive;
+        pumpStream();
+    }
+
+    // The response never ends: the connection is handed to the worker, which
+    // writes events to it until the browser goes away
+    void startEventStream() {
+        eventStream = true;
+        idleTimer.stop();
+        socket->write("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n\r\n"
+                      "retry: 1000\n\n");
+        emit eventStreamStarted(this);
+    }
+
+    // Answers a satisfiable Range request with 206. Callers parse the range
+    // first, so the file only changes hands once the 206 is certain. Parts
+    // come from data when no file is given; file parts are read
+    // positionally as the socket drains.
+    void sendRanges(const HttpRequest &request, const QVector<ByteRange> &ranges, const QByteArray &contentType,
+                    const QByteArray &validators, qint64 size, const QByteArray &data, std::unique_ptr<QFile> file) {
+        const bool fromFile = file != nullptr;
+        std::unique_ptr<ResponseStream> body(new ResponseStream(std::move(file)));
+        auto addPart = [&](const ByteRange &range) {
+            if (fromFile) {
+                body->addFileRange(range.first, range.length());
+            } else {
+                body->addBytes(data.mid(range.first, range.length()));
+            }
+        };
+        auto contentRange = [size](const ByteRange &range) {
+            return "Content-Range: bytes " + QByteArray::number(range.first) + '-' + QByteArray::number(range.last)
+                   + '/' + QByteArray::number(size) + "\r\n";
+        };
+
+        QByteArray headers;
+        qint64 length = 0;
+        if (ranges.size() == 1) {
+            headers = "Content-Type: " + contentType + "\r\n" + contentRange(ranges.first());
+            length = ranges.first().length();
+            addPart(ranges.first());
         } else {
-            setStyleSheet(R"(
-                QTextEdit {
-                    background-color: #ffffff;
-                    color: #000000;
-                    border: none;
-                    font-family: 'Consolas', 'Courier New', monospace;
-                    font-size: 14px;
-                }
-            )");
+            const QByteArray boundary = QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+            headers = "Content-Type: multipart/byteranges; boundary=" + boundary + "\r\n";
+            for (const ByteRange &range : ranges) {
+                const QByteArray partHead = "\r\n--" + boundary + "\r\nContent-Type: " + contentType + "\r\n"
+                                            + contentRange(range) + "\r\n";
+                body->addBytes(partHead);
+                addPart(range);
+                length += partHead.size() + range.length();
+            }
+            const QByteArray tail = "\r\n--" + boundary + "--\r\n";
+            body->addBytes(tail);
+            length += tail.size();
+        }
+
+        writeHead(request, 206, headers + validators, length);
+        stream = std::move(body);
+        streamKeepAlive = request.keepAlive;
+        pumpStream();
+    }
+
+    void pumpStream() {
+        if (!stream->pump(socket)) return;
+        const bool failed = stream->failed();
+        stream.reset();
+        // After a failed read the promised Content-Length cannot be met
+        if (failed || !streamKeepAlive) {
+            close();
+            return;
+        }
+        processRequests();
+    }
+
+    void sendError(const HttpRequest &request, int status, const QByteArray &headers = QByteArray()) {
+        const QByteArray body = "<h1>" + QByteArray::number(status) + ' ' + httpReasonPhrase(status) + "</h1>";
+        writeHead(request, status, headers + "Content-Type: text/html\r\n", body.size());
+        if (!request.isHead()) {
+            socket->write(body);
+        }
+        finishResponse(request);
+    }
+
+    // A negative length means headers already carry Content-Length
+    void writeHead(const HttpRequest &request, int status, const QByteArray &headers, qint64 contentLength = -1) {
+        QByteArray head = "HTTP/1.1 " + QByteArray::number(status) + ' ' + httpReasonPhrase(status) + "\r\n";
+        head += headers;
+        if (contentLength >= 0) {
+            head += "Content-Length: " + QByteArray::number(contentLength) + "\r\n";
+        }
+        if (!request.keepAlive) {
+            head += "Connection: close\r\n";
+        } else if (request.minorVersion == 0) {
+            head += "Connection: keep-alive\r\n";
+        }
+        head += "\r\n";
+        socket->write(head);
+    }
+
+    void finishResponse(const HttpRequest &request) {
+        if (!request.keepAlive) {
+            close();
+        }
+    }
+
+    void close() {
+        closing = true;
+        idleTimer.stop();
+        // Flushes anything still queued before the socket goes away
+        socket->disconnectFromHost();
+    }
+
+    QTcpSocket *socket;
+    std::shared_ptr<ServerContext> context;
+    HttpRequestParser parser;
+    QTimer idleTimer;
+    std::unique_ptr<ResponseStream> stream;
+    bool streamKeepAlive = true;
+    bool eventStream = false;
+    bool closing = false;
+};
+
+// Owns the connections handed to one server thread. Sockets are created and
+// serviced inside that thread's event loop, so a slow request never stalls
+// the editor or connections assigned to other threads.
+class ServerWorker : public QObject {
+    Q_OBJECT
+
+public:
+    ServerWorker(std::shared_ptr<ServerContext> context) : context(std::move(context)) {
+        // Comments keep idle event streams from being dropped by proxies
+        heartbeat = new QTimer(this);
+        heartbeat->setInterval(20000);
+        connect(heartbeat, &QTimer::timeout, this, [this]() { broadcast(": ping\n\n"); });
+    }
+
+    int connectionCount() const { return connections.loadRelaxed(); }
+
+    void handleConnection(qintptr descriptor) {
+        QTcpSocket *socket = new QTcpSocket(this);
+        if (!socket->setSocketDescriptor(descriptor)) {
+            delete socket;
+            connections.deref();
+            return;
+        }
+        HttpConnection *connection = new HttpConnection(socket, context, this);
+        connect(connection, &HttpConnection::eventStreamStarted, this, [this](HttpConnection *stream) {
+            eventStreams.insert(stream);
+            heartbeat->start();
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, connection]() {
+            connections.deref();
+            eventStreams.remove(connection);
+            if (eventStreams.isEmpty()) heartbeat->stop();
+            connection->deleteLater();
+        });
+    }
+
+    // Called from the listening thread before the descriptor is queued
+    void reserveConnection() { connections.ref(); }
+
+    void broadcast(const QByteArray &event) {
+        for (HttpConnection *stream : std::as_const(eventStreams)) {
+            stream->sendEvent(event);
+        }
+    }
+
+private:
+    std::shared_ptr<ServerContext> context;
+    QAtomicInt connections;
+    QSet<HttpConnection*> eventStreams;
+    QTimer *heartbeat;
+};
+
+// Preview HTTP server. The listening socket stays on the GUI thread, but
+// every accepted connection is handed to the least busy of a fixed pool of
+// worker threads, each running its own event loop.
+class PreviewServer : public QTcpServer {
+    Q_OBJECT
+
+public:
+    PreviewServer(QObject *parent = nullptr) : QTcpServer(parent) {
+        assetCache = new AssetCache(64 * 1024 * 1024, this);
+        pathIndex = new PathIndex(this);
+        context = std::make_shared<ServerContext>(assetCache, pathIndex);
+        const int threadCount = qBound(2, QThread::idealThreadCount(), 8);
+        for (int i = 0; i < threadCount; ++i) {
+            QThread *thread = new QThread(this);
+            ServerWorker *worker = new ServerWorker(context);
+            worker->moveToThread(thread);
+            connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+            thread->start();
+            threads.append(thread);
+            workers.append(worker);
+        }
+
+        reloadTimer.setSingleShot(true);
+        reloadTimer.setInterval(150);
+        connect(&reloadTimer, &QTimer::timeout, this, &PreviewServer::sendReload);
+        connect(assetCache, &AssetCache::fileChanged, this, &PreviewServer::notifyChanged);
+        connect(pathIndex, &PathIndex::fileChanged, this, &PreviewServer::notifyChanged);
+        connect(pathIndex, &PathIndex::ignoreFileChanged, this, &PreviewServer::ignoreFileChanged);
+    }
+
+    ~PreviewServer() {
+        close();
+        for (QThread *thread : threads) {
+            thread->quit();
+            thread->wait();
+        }
+    }
+
+    void setRootPath(const QString &path) {
+        context->setRootPath(path);
+        assetCache->clear();
+        pathIndex->setRoot(path, std::make_shared<IgnoreMatcher>(path, excludePatterns));
+    }
+
+    // Ignored files are still served; they are just not indexed or watched
+    void setExcludePatterns(const QStringList &patterns) {
+        excludePatterns = patterns;
+        const QString root = context->rootPath();
+        if (!root.isEmpty()) {
+            pathIndex->setRoot(root, std::make_shared<IgnoreMatcher>(root, excludePatterns));
         }
     }
 
-    void setFileType(const QString &type) {
-        currentFileType = type;
-        setupAutoComplete();
+    // Only the folder the changed .gitignore is in is indexed again
+    void reloadIgnoreRules(const QString &folder) {
+        pathIndex->reloadIgnoreRules(folder);
     }
 
-    void showImportPanel() {
-        if (currentFileType == "html" || currentFileType == "htm" || 
-            currentFileType == "xhtml" || currentFileType == "xhtm" || currentFileType == "htma") {
-            emit requestImportPanel();
+    void setSpaFallbackEnabled(bool enabled) { context->setSpaFallbackEnabled(enabled); }
+
+    void setCacheControlRules(const QStringList &rules) {
+        context->setCacheControlRules(rules);
+        // Cached responses carry the old Cache-Control line
+        assetCache->clear();
+    }
+
+    AssetCache *cache() const { return assetCache; }
+
+    void setLiveReloadEnabled(bool enabled) {
+        context->setLiveReloadEnabled(enabled);
+        // Cached HTML was built with or without the injected script
+        assetCache->clear();
+    }
+
+    // Queues a reload for a file below the root. Bursts of changes, such as
+    // Save All or an editor's write-then-rename, go out as a single event.
+    void notifyChanged(const QString &path) {
+        // The watcher may not have caught up yet, and the reload must not see the old body
+        assetCache->invalidate(path);
+        const QString root = context->rootPath();
+        if (!isListening() || !context->liveReloadEnabled() || root.isEmpty()
+            || !path.startsWith(root + QLatin1Char('/'))) {
+            return;
         }
+        pendingChanges.insert(QString::fromLatin1(QUrl::toPercentEncoding(path.mid(root.size()), "/")));
+        reloadTimer.start();
     }
 
 signals:
-    void requestImportPanel();
+    // Seen by the index, which watches folders the explorer never listed
+    void ignoreFileChanged(const QString &folder);
 
-public slots:
-    void onTextChanged() {
-        // Show suggestions as you type
-        QTextCursor cursor = textCursor();
-        cursor.select(QTextCursor::WordUnderCursor);
-        QString word = cursor.selectedText();
-        
-        if (word.length() > 1) {
-            if (completer && completer->completionCount() > 0) {
-                completer->setCompletionPrefix(word);
-                QRect cr = cursorRect();
-                cr.setWidth(completer->popup()->sizeHintForColumn(0) 
-                    + completer->popup()->verticalScrollBar()->sizeHint().width());
-                completer->complete(cr);
+protected:
+    void incomingConnection(qintptr descriptor) override {
+        ServerWorker *target = workers.first();
+        for (ServerWorker *worker : workers) {
+            if (worker->connectionCount() < target->connectionCount()) {
+                target = worker;
             }
         }
+        target->reserveConnection();
+        QMetaObject::invokeMethod(target, [target, descriptor]() {
+            target->handleConnection(descriptor);
+        }, Qt::QueuedConnection);
     }
 
 private:
-    void setupAutoComplete() {
-        QStringList suggestions;
-        
-        if (currentFileType == "html" || currentFileType == "htm" || 
-            currentFileType == "xhtml" || currentFileType == "xhtm" || currentFileType == "htma") {
-            suggestions << "<!DOCTYPE html>" << "<html>" << "</html>" << "<head>" << "</head>"
-                       << "<body>" << "</body>" << "<div>" << "</div>" << "<span>" << "</span>"
-                       << "<script>" << "</script>" << "<link>" << "<style>" << "</style>"
-                       << "<title>" << "</title>" << "<meta>" << "<form>" << "</form>"
-                       << "<input>" << "<button>" << "</button>" << "<a>" << "</a>"
-                       << "<img>" << "<ul>" << "</ul>" << "<li>" << "</li>" << "<p>" << "</p>"
-                       << "<h1>" << "</h1>" << "<h2>" << "</h2>" << "<h3>" << "</h3>"
-                       << "<table>" << "</table>" << "<tr>" << "</tr>" << "<td>" << "</td>"
-                       << "class=\"\"" << "id=\"\"" << "href=\"\"" << "src=\"\"";
-        } else if (currentFileType == "css") {
-            suggestions << "background-color:" << "color:" << "font-size:" << "margin:" << "padding:"
-                       << "width:" << "height:" << "display:" << "position:" << "border:"
-                       << "flex" << "grid" << "absolute" << "relative" << "fixed"
-                       << "background:" << "border-radius:" << "box-shadow:" << "text-align:"
-                       << "font-family:" << "font-weight:" << "line-height:" << "opacity:"
-                       << "transition:" << "transform:" << "justify-content:" << "align-items:";
-        } else if (currentFileType == "js") {
-            suggestions << "function" << "const" << "let" << "var" << "return" << "if" << "else"
-                       << "for" << "while" << "switch" << "case" << "break" << "continue"
-                       << "document.getElementById" << "document.querySelector"
-                       << "document.querySelectorAll" << "addEventListener" << "console.log"
-                       << "fetch" << "async" << "await" << "Promise" << "setTimeout" << "setInterval"
-                       << "class" << "constructor" << "this" << "new" << "export" << "import";
+    void sendReload() {
+        QJsonArray paths;
+        for (const QString &path : std::as_const(pendingChanges)) {
+            paths.append(path);
         }
-        
-        if (!suggestions.isEmpty()) {
-            completer = new QCompleter(suggestions, this);
-            completer->setWidget(this);
-            completer->setCompletionMode(QCompleter::PopupCompletion);
-            completer->setCaseSensitivity(Qt::CaseInsensitive);
-            
-            connect(completer, QOverload<const QString &>::of(&QCompleter::activated),
-                    this, &CodeEditor::insertCompletion);
+        pendingChanges.clear();
+        const QByteArray event = "data: " + QJsonDocument(paths).toJson(QJsonDocument::Compact) + "\n\n";
+        for (ServerWorker *worker : workers) {
+            QMetaObject::invokeMethod(worker, [worker, event]() { worker->broadcast(event); }, Qt::QueuedConnection);
         }
     }
 
-    void insertCompletion(const QString &completion) {
-        QTextCursor cursor = textCursor();
-        cursor.select(QTextCursor::WordUnderCursor);
-        cursor.removeSelectedText();
-        cursor.insertText(completion);
-        setTextCursor(cursor);
-    }
-
-    CodeHighlighter *highlighter;
-    QCompleter *completer = nullptr;
-    QString currentFileType;
+    AssetCache *assetCache;
+    PathIndex *pathIndex;
+    std::shared_ptr<ServerContext> context;
+    QStringList excludePatterns;
+    QVector<QThread*> threads;
+    QVector<ServerWorker*> workers;
+    QTimer reloadTimer;
+    QSet<QString> pendingChanges;
 };
 
 // Main IDE Window
@@ -280,8 +4980,12 @@ class WebIDE : public QMainWindow {
     Q_OBJECT
 
 public:
-    WebIDE(QWidget *parent = nullptr) : QMainWindow(parent), serverPort(8080), isDarkTheme(true) {
+    WebIDE(QWidget *parent = nullptr) : QMainWindow(parent), serverPort(8080), isDarkTheme(true),
+                                          largeFileSizeMB(5), largeFileLineLength(5000),
+                                          showLineNumbers(true) {
         setupUI();
+        saveQueue = new SaveQueue(this);
+        connect(saveQueue, &SaveQueue::saveFinished, this, &WebIDE::onSaveFinished);
         applyTheme(isDarkTheme);
         loadSettings();
         setupServer();
@@ -312,6 +5016,7 @@ private slots:
             QStringList folders = dialog.selectedFiles();
             if (!folders.isEmpty()) {
                 currentFolder = folders.first();
+                server->setRootPath(currentFolder);
                 loadFolderStructure(currentFolder);
                 statusBar()->showMessage("Opened folder: " + currentFolder, 3000);
             }
@@ -431,6 +5136,7 @@ private slots:
             if (item && item->data(Qt::UserRole).isValid()) {
                 QString path = item->data(Qt::UserRole).toString();
                 currentFolder = path;
+                server->setRootPath(currentFolder);
                 loadFolderStructure(currentFolder);
                 
                 // Save to recent folders
@@ -452,6 +5158,7 @@ private slots:
             if (item && item->data(Qt::UserRole).isValid()) {
                 QString path = item->data(Qt::UserRole).toString();
                 currentFolder = path;
+                server->setRootPath(currentFolder);
                 loadFolderStructure(currentFolder);
                 
                 // Save to recent folders
@@ -479,7 +5186,7 @@ private slots:
                 QFile file(filePath);
                 if (file.open(QIODevice::WriteOnly)) {
                     file.close();
-                    loadFolderStructure(currentFolder);
+                    fileModel->insertPath(filePath, false);
                     openFileInEditor(filePath);
                 }
             } else {
@@ -495,7 +5202,7 @@ private slots:
             if (!currentFolder.isEmpty()) {
                 QDir dir(currentFolder);
                 if (dir.mkdir(folderName)) {
-                    loadFolderStructure(currentFolder);
+                    fileModel->insertPath(dir.filePath(folderName), true);
                 }
             } else {
                 QMessageBox::warning(this, "Warning", "Please open a folder first");
@@ -508,36 +5215,85 @@ private slots:
             QString filePath = tabWidget->tabToolTip(tabWidget->currentIndex());
             CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->currentWidget());
             if (editor && !filePath.isEmpty()) {
-                QFile file(filePath);
-                if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                    QTextStream out(&file);
-                    out << editor->toPlainText();
-                    file.close();
-                    statusBar()->showMessage("File saved: " + filePath, 3000);
+                if (!editor->isFullyLoaded()) {
+                    statusBar()->showMessage("Still loading, not saved: " + filePath, 3000);
+                    return;
                 }
+                queueSave(filePath, editor, false);
             }
         }
     }
 
+    // Only buffers that differ from disk are written. Unmodified tabs are
+    // skipped outright; modified ones are hashed on the save worker and
+    // skipped too if the edits were undone back to the saved text.
     void saveAllFiles() {
         for (int i = 0; i < tabWidget->count(); ++i) {
             QString filePath = tabWidget->tabToolTip(i);
             CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
-            if (editor && !filePath.isEmpty()) {
-                QFile file(filePath);
-                if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                    QTextStream out(&file);
-                    out << editor->toPlainText();
-                    file.close();
+            if (editor && !filePath.isEmpty() && editor->isFullyLoaded()) {
+                if (editor->document()->isModified()) {
+                    queueSave(filePath, editor, true);
+                } else {
+                    ++savesSkipped;
+                }
+            }
+        }
+        if (savesInFlight.isEmpty()) {
+            statusBar()->showMessage(QString("No changes to save (%1 unchanged)").arg(savesSkipped), 3000);
+            savesSkipped = 0;
+        }
+    }
+
+    void onSaveFinished(const QString &path, bool ok, const QString &error, const QByteArray &hash, bool skipped) {
+        if (!ok) {
+            saveErrors << QFileInfo(path).fileName() + ": " + error;
+        }
+        if (!saveQueue->isSaving(path)) {
+            savesInFlight.remove(path);
+            const quint64 serial = saveSerials.take(path);
+            CodeEditor *editor = editorForPath(path);
+            if (ok && editor) {
+                editor->markSaved(hash, serial);
+            }
+        }
+        if (skipped) {
+            ++savesSkipped;
+        } else {
+            ++savesDone;
+            if (ok) {
+                server->notifyChanged(path);
+                if (QFileInfo(path).fileName() == ".gitignore") {
+                    ignoreFileChanged(QFileInfo(path).absolutePath());
                 }
             }
         }
-        statusBar()->showMessage("All files saved", 3000);
+
+        if (!savesInFlight.isEmpty()) {
+            statusBar()->showMessage(QString("Saved %1 (%2 of %3)")
+                .arg(QFileInfo(path).fileName()).arg(savesDone).arg(savesDone + savesInFlight.size()));
+            return;
+        }
+
+        // Batch complete
+        if (saveErrors.isEmpty()) {
+            QString message = savesDone == 1 && savesSkipped == 0 ? "File saved: " + path
+                                                                  : QString("%1 files saved").arg(savesDone);
+            if (savesSkipped > 0) {
+                message += QString(", %1 unchanged skipped").arg(savesSkipped);
+            }
+            statusBar()->showMessage(message, 3000);
+        } else {
+            statusBar()->showMessage(QString("%1 of %2 files failed to save").arg(saveErrors.size()).arg(savesDone), 5000);
+            QMessageBox::warning(this, "Save Failed", "Could not save:\n\n" + saveErrors.join("\n"));
+        }
+        savesDone = 0;
+        savesSkipped = 0;
+        saveErrors.clear();
     }
 
-    void onTreeItemDoubleClicked(QTreeWidgetItem *item, int column) {
-        Q_UNUSED(column);
-        QString filePath = item->data(0, Qt::UserRole).toString();
+    void onTreeItemDoubleClicked(const QModelIndex &index) {
+        QString filePath = index.data(Qt::UserRole).toString();
         if (!filePath.isEmpty() && QFileInfo(filePath).isFile()) {
             openFileInEditor(filePath);
         }
@@ -550,6 +5306,8 @@ private slots:
     void startServer() {
         if (server->isListening()) {
             server->close();
+            cacheStatsTimer->stop();
+            cacheStatsLabel->hide();
             serverBtn->setText("Start Server");
             serverStatusLabel->setText("Server: Stopped");
             statusBar()->showMessage("Server stopped", 3000);
@@ -573,6 +5331,9 @@ private slots:
                 }
                 
                 serverStatusLabel->setText(serverInfo);
+                updateCacheStats();
+                cacheStatsLabel->show();
+                cacheStatsTimer->start();
                 statusBar()->showMessage("Server started on port " + QString::number(serverPort), 3000);
             } else {
                 QMessageBox::warning(this, "Error", "Could not start server on port " + QString::number(serverPort));
@@ -692,11 +5453,62 @@ private slots:
         editorLayout->addWidget(syntaxHighlight);
         
         QCheckBox *lineNumbers = new QCheckBox("Show Line Numbers");
-        lineNumbers->setChecked(false);
+        lineNumbers->setChecked(showLineNumbers);
         editorLayout->addWidget(lineNumbers);
         
         editorGroup->setLayout(editorLayout);
         mainLayout->addWidget(editorGroup);
+
+        // Large file thresholds
+        QGroupBox *largeFileGroup = new QGroupBox("Large Files");
+        QFormLayout *largeFileLayout = new QFormLayout();
+
+        QSpinBox *largeFileSizeSpin = new QSpinBox();
+        largeFileSizeSpin->setRange(1, 1024);
+        largeFileSizeSpin->setSuffix(" MB");
+        largeFileSizeSpin->setValue(largeFileSizeMB);
+        largeFileLayout->addRow("Open as large file above:", largeFileSizeSpin);
+
+        QSpinBox *largeFileLineSpin = new QSpinBox();
+        largeFileLineSpin->setRange(100, 10000000);
+        largeFileLineSpin->setSuffix(" chars");
+        largeFileLineSpin->setValue(largeFileLineLength);
+        largeFileLayout->addRow("Or with a line longer than:", largeFileLineSpin);
+
+        largeFileGroup->setLayout(largeFileLayout);
+        mainLayout->addWidget(largeFileGroup);
+
+        // Explorer
+        QGroupBox *explorerGroup = new QGroupBox("Explorer");
+        QFormLayout *explorerLayout = new QFormLayout();
+
+        QPlainTextEdit *excludeEdit = new QPlainTextEdit(excludePatterns.join("\n"));
+        excludeEdit->setPlaceholderText("node_modules\n*.min.js\nbuild/");
+        excludeEdit->setMaximumHeight(80);
+        explorerLayout->addRow("Exclude (plus .gitignore):", excludeEdit);
+
+        explorerGroup->setLayout(explorerLayout);
+        mainLayout->addWidget(explorerGroup);
+
+        // Preview server
+        QGroupBox *serverGroup = new QGroupBox("Preview Server");
+        QFormLayout *serverLayout = new QFormLayout();
+
+        QPlainTextEdit *cacheControlEdit = new QPlainTextEdit(cacheControlRules.join("\n"));
+        cacheControlEdit->setPlaceholderText("*.html = no-cache\nassets/* = max-age=3600");
+        cacheControlEdit->setMaximumHeight(80);
+        serverLayout->addRow("Cache-Control rules:", cacheControlEdit);
+
+        QCheckBox *liveReloadCheck = new QCheckBox("Reload the browser when files change");
+        liveReloadCheck->setChecked(liveReload);
+        serverLayout->addRow(liveReloadCheck);
+
+        QCheckBox *spaFallbackCheck = new QCheckBox("Serve index.html for unknown routes (single-page apps)");
+        spaFallbackCheck->setChecked(spaFallback);
+        serverLayout->addRow(spaFallbackCheck);
+
+        serverGroup->setLayout(serverLayout);
+        mainLayout->addWidget(serverGroup);
         
         mainLayout->addStretch();
         
@@ -717,6 +5529,33 @@ private slots:
         // Connect buttons
         connect(cancelBtn, &QPushButton::clicked, &dialog, &QDialog::reject);
         connect(applyBtn, &QPushButton::clicked, [&]() {
+            largeFileSizeMB = largeFileSizeSpin->value();
+            largeFileLineLength = largeFileLineSpin->value();
+            updateEditorModeLabel();
+
+            cacheControlRules = cacheControlEdit->toPlainText().split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+            server->setCacheControlRules(cacheControlRules);
+            if (liveReloadCheck->isChecked() != liveReload) {
+                liveReload = liveReloadCheck->isChecked();
+                server->setLiveReloadEnabled(liveReload);
+            }
+            spaFallback = spaFallbackCheck->isChecked();
+            server->setSpaFallbackEnabled(spaFallback);
+
+            const QStringList excludes = excludeEdit->toPlainText().split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+            if (excludes != excludePatterns) {
+                excludePatterns = excludes;
+                applyIgnoreRules();
+            }
+
+            showLineNumbers = lineNumbers->isChecked();
+            for (int i = 0; i < tabWidget->count(); ++i) {
+                CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->widget(i));
+                if (editor) {
+                    editor->setLineNumbersVisible(showLineNumbers);
+                }
+            }
+
             bool newTheme = darkRadio->isChecked();
             if (newTheme != isDarkTheme) {
                 isDarkTheme = newTheme;
@@ -751,7 +5590,9 @@ private slots:
         if (!currentFolder.isEmpty()) {
             QDir dir(currentFolder);
             QFileInfoList entries = dir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+            const IgnoreMatcher::Scope ignored = IgnoreMatcher(currentFolder, excludePatterns).scope("");
             for (const QFileInfo &info : entries) {
+                if (ignored.ignores(info.fileName(), false)) continue;
                 QListWidgetItem *item = new QListWidgetItem(info.fileName());
                 item->setCheckState(Qt::Unchecked);
                 item->setData(Qt::UserRole, info.absoluteFilePath());
@@ -838,41 +5679,6 @@ private slots:
         dialog.exec();
     }
 
-    void handleNewConnection() {
-        QTcpSocket *socket = server->nextPendingConnection();
-        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
-            QString request = socket->readAll();
-            
-            // Parse requested file
-            QString requestedFile = "/index.html";
-            QRegularExpression re("GET\\s+([^\\s]+)");
-            QRegularExpressionMatch match = re.match(request);
-            if (match.hasMatch()) {
-                requestedFile = match.captured(1);
-                if (requestedFile == "/") requestedFile = "/index.html";
-            }
-
-            QString filePath = currentFolder + requestedFile;
-            QFile file(filePath);
-            
-            QString response;
-            if (file.open(QIODevice::ReadOnly)) {
-                QByteArray content = file.readAll();
-                response = "HTTP/1.1 200 OK\r\n";
-                response += "Content-Type: text/html\r\n";
-                response += "Content-Length: " + QString::number(content.size()) + "\r\n";
-                response += "\r\n";
-                socket->write(response.toUtf8());
-                socket->write(content);
-            } else {
-                response = "HTTP/1.1 404 Not Found\r\n\r\n<h1>404 Not Found</h1>";
-                socket->write(response.toUtf8());
-            }
-            
-            socket->disconnectFromHost();
-        });
-    }
-
 private:
     void setupUI() {
         setWindowTitle("Web IDE - Full Featured");
@@ -911,16 +5717,16 @@ private:
         leftPanel->setMaximumWidth(300);
         
         // Explorer tab
-        fileTree = new QTreeWidget();
-        fileTree->setHeaderLabel("Explorer");
+        crawler = new DirectoryCrawler(this);
+        treeWatcher = new TreeWatcher(this);
+        fileModel = new FileTreeModel(crawler, treeWatcher, this);
+        fileTree = new QTreeView();
+        fileTree->setModel(fileModel);
+        fileTree->setUniformRowHeights(true);
         fileTree->setContextMenuPolicy(Qt::CustomContextMenu);
-        fileTree->setDragEnabled(true);
-        fileTree->setAcceptDrops(true);
-        fileTree->setDropIndicatorShown(true);
-        fileTree->setDragDropMode(QAbstractItemView::InternalMove);
         
-        connect(fileTree, &QTreeWidget::itemDoubleClicked, this, &WebIDE::onTreeItemDoubleClicked);
-        connect(fileTree, &QTreeWidget::customContextMenuRequested, this, &WebIDE::showContextMenu);
+        connect(fileTree, &QTreeView::doubleClicked, this, &WebIDE::onTreeItemDoubleClicked);
+        connect(fileTree, &QTreeView::customContextMenuRequested, this, &WebIDE::showContextMenu);
         leftPanel->addTab(fileTree, "Explorer");
 
         // Export tab
@@ -961,15 +5767,43 @@ private:
         setCentralWidget(centralWidget);
 
         // Status bar
+        editorModeLabel = new QLabel();
+        statusBar()->addPermanentWidget(editorModeLabel);
         statusBar()->showMessage("Ready");
+
+        // Folder listing progress, shown once the crawler has been busy for a moment
+        scanLabel = new QLabel();
+        scanProgress = new QProgressBar();
+        scanProgress->setRange(0, 0);
+        scanProgress->setMaximumWidth(120);
+        scanCancelButton = new QPushButton("Cancel");
+        scanCancelButton->setFlat(true);
+        statusBar()->addPermanentWidget(scanLabel);
+        statusBar()->addPermanentWidget(scanProgress);
+        statusBar()->addPermanentWidget(scanCancelButton);
+        showScanProgress(false);
+        scanDelayTimer = new QTimer(this);
+        scanDelayTimer->setSingleShot(true);
+        scanDelayTimer->setInterval(300);
+        connect(scanDelayTimer, &QTimer::timeout, this, [this]() { showScanProgress(true); });
+
+        connect(crawler, &DirectoryCrawler::started, this, [this]() {
+            scanLabel->setText("Listing folders...");
+            scanDelayTimer->start();
+        });
+        connect(crawler, &DirectoryCrawler::progress, this, [this](int directories, int files) {
+            scanLabel->setText(QString("Listing: %1 folders, %2 entries").arg(directories).arg(files));
+        });
+        connect(crawler, &DirectoryCrawler::finished, this, &WebIDE::onScanFinished);
+        connect(scanCancelButton, &QPushButton::clicked, crawler, &DirectoryCrawler::cancel);
     }
 
     void showContextMenu(const QPoint &pos) {
-        QTreeWidgetItem *item = fileTree->itemAt(pos);
+        QModelIndex index = fileTree->indexAt(pos);
         QMenu contextMenu;
         
-        if (item) {
-            QString itemPath = item->data(0, Qt::UserRole).toString();
+        if (index.isValid()) {
+            QString itemPath = index.data(Qt::UserRole).toString();
             QFileInfo info(itemPath);
             
             if (info.isDir()) {
@@ -1050,7 +5884,7 @@ private:
             QFile file(filePath);
             if (file.open(QIODevice::WriteOnly)) {
                 file.close();
-                loadFolderStructure(currentFolder);
+                fileModel->insertPath(filePath, false);
                 openFileInEditor(filePath);
                 statusBar()->showMessage("Created file: " + fileName, 3000);
             } else {
@@ -1065,7 +5899,7 @@ private:
         if (ok && !folderName.isEmpty()) {
             QDir dir(folderPath);
             if (dir.mkdir(folderName)) {
-                loadFolderStructure(currentFolder);
+                fileModel->insertPath(dir.filePath(folderName), true);
                 statusBar()->showMessage("Created folder: " + folderName, 3000);
             } else {
                 QMessageBox::warning(this, "Error", "Could not create folder");
@@ -1086,14 +5920,14 @@ private:
             if (info.isDir()) {
                 QDir dir(path);
                 if (dir.removeRecursively()) {
-                    loadFolderStructure(currentFolder);
+                    fileModel->removePath(path);
                     statusBar()->showMessage("Deleted folder: " + info.fileName(), 3000);
                 } else {
                     QMessageBox::warning(this, "Error", "Could not delete folder");
                 }
             } else {
                 if (QFile::remove(path)) {
-                    loadFolderStructure(currentFolder);
+                    fileModel->removePath(path);
                     statusBar()->showMessage("Deleted file: " + info.fileName(), 3000);
                 } else {
                     QMessageBox::warning(this, "Error", "Could not delete file");
@@ -1224,15 +6058,15 @@ private:
         qApp->setPalette(darkPalette);
         
         setStyleSheet(R"(
-            QTreeWidget {
+            QTreeView {
                 background-color: #252526;
                 color: #cccccc;
                 border: none;
             }
-            QTreeWidget::item:selected {
+            QTreeView::item:selected {
                 background-color: #094771;
             }
-            QTreeWidget::item:hover {
+            QTreeView::item:hover {
                 background-color: #2a2d2e;
             }
             QTabWidget::pane {
@@ -1294,16 +6128,16 @@ private:
         qApp->setPalette(lightPalette);
         
         setStyleSheet(R"(
-            QTreeWidget {
+            QTreeView {
                 background-color: #ffffff;
                 color: #000000;
                 border: 1px solid #cccccc;
             }
-            QTreeWidget::item:selected {
+            QTreeView::item:selected {
                 background-color: #0078d4;
                 color: white;
             }
-            QTreeWidget::item:hover {
+            QTreeView::item:hover {
                 background-color: #e5e5e5;
             }
             QTabWidget::pane {
@@ -1346,57 +6180,100 @@ private:
         )");
     }
 
+    // Only the project folder is listed here; the view fetches the rest as
+    // folders are expanded. Loading the folder that is already shown (opening
+    // it again, new ignore rules) lists the loaded folders again and merges
+    // them into the tree, so expansion, selection and scroll position stay.
     void loadFolderStructure(const QString &path) {
-        fileTree->clear();
-        QDir dir(path);
-        QTreeWidgetItem *rootItem = new QTreeWidgetItem(fileTree);
-        rootItem->setText(0, dir.dirName());
-        rootItem->setData(0, Qt::UserRole, path);
-        rootItem->setIcon(0, style()->standardIcon(QStyle::SP_DirIcon));
-        
-        addTreeItems(rootItem, path);
-        fileTree->expandItem(rootItem);
+        const auto matcher = std::make_shared<IgnoreMatcher>(path, excludePatterns);
+        if (path == fileModel->rootPath()) {
+            fileModel->setIgnoreMatcher(matcher);
+            fileModel->refresh();
+            return;
+        }
+        fileModel->setRootPath(path, matcher);
+        fileTree->expand(fileModel->projectIndex());
     }
 
-    void addTreeItems(QTreeWidgetItem *parent, const QString &path) {
-        QDir dir(path);
-        QFileInfoList entries = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot, QDir::DirsFirst);
-        
-        for (const QFileInfo &info : entries) {
-            QTreeWidgetItem *item = new QTreeWidgetItem(parent);
-            item->setText(0, info.fileName());
-            item->setData(0, Qt::UserRole, info.absoluteFilePath());
-            
-            if (info.isDir()) {
-                item->setIcon(0, style()->standardIcon(QStyle::SP_DirIcon));
-                addTreeItems(item, info.absoluteFilePath());
-            } else {
-                // Set file type icon
-                QString ext = info.suffix().toLower();
-                if (ext == "html" || ext == "htm" || ext == "xhtml") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_FileDialogDetailedView));
-                } else if (ext == "css") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_FileDialogContentsView));
-                } else if (ext == "js") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_CommandLink));
-                } else if (ext == "php") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_ComputerIcon));
-                } else if (ext == "jpg" || ext == "jpeg" || ext == "png" || ext == "gif" || ext == "bmp" || ext == "svg") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_FileDialogInfoView));
-                } else if (ext == "json" || ext == "xml") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_FileDialogListView));
-                } else if (ext == "txt" || ext == "md") {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_FileIcon));
-                } else {
-                    item->setIcon(0, style()->standardIcon(QStyle::SP_FileIcon));
-                }
-            }
+    // Exclude patterns changed, which can hide or reveal entries anywhere
+    void applyIgnoreRules() {
+        server->setExcludePatterns(excludePatterns);
+        if (!currentFolder.isEmpty()) {
+            loadFolderStructure(currentFolder);
+        }
+    }
+
+    void ignoreFileChanged(const QString &folder) {
+        changedIgnoreFolders.insert(folder);
+        ignoreRulesTimer->start();
+    }
+
+    // A .gitignore only governs its own folder, so only that subtree is
+    // listed and indexed again
+    void reloadIgnoreRules() {
+        const QSet<QString> folders = changedIgnoreFolders;
+        changedIgnoreFolders.clear();
+        for (const QString &folder : folders) {
+            fileModel->reloadIgnoreRules(folder);
+            server->reloadIgnoreRules(folder);
+        }
+    }
+
+    void onScanFinished(bool cancelled) {
+        scanDelayTimer->stop();
+        showScanProgress(false);
+        if (cancelled) {
+            statusBar()->showMessage("Folder listing cancelled", 3000);
         }
     }
 
+    void showScanProgress(bool visible) {
+        scanLabel->setVisible(visible);
+        scanProgress->setVisible(visible);
+        scanCancelButton->setVisible(visible);
+    }
+
     void onTabChanged(int index) {
         Q_UNUSED(index);
         updateImportPanel();
+        updateEditorModeLabel();
+    }
+
+    void updateEditorModeLabel() {
+        QString limits = QString("%1 MB / %2 chars per line").arg(largeFileSizeMB).arg(largeFileLineLength);
+        CodeEditor *editor = qobject_cast<CodeEditor*>(tabWidget->currentWidget());
+        if (editor && editor->isLargeFileMode()) {
+            editorModeLabel->setText("Large file mode (limits: " + limits + ")");
+        } else {
+            editorModeLabel->setText("Normal mode (large file above " + limits + ")");
+        }
+    }
+
+    void updateCacheStats() {
+        const AssetCache::Stats stats = server->cache()->statistics();
+        cacheStatsLabel->setText(QString("Cache: %1 hits, %2 misses, %3 evictions (%4 files, %5 KB)")
+                                     .arg(stats.hits).arg(stats.misses).arg(stats.evictions)
+                                     .arg(stats.entries).arg(stats.bytes / 1024));
+    }
+
+    // A file opens in large-file mode when it is bigger than the size
+    // threshold or has a line longer than the line threshold (minified
+    // bundles, JSON dumps).
+    bool isLargeFile(QByteArrayView data) const {
+        if (data.size() >= qint64(largeFileSizeMB) * 1024 * 1024) {
+            return true;
+        }
+        const char *begin = data.constData();
+        const char *end = begin + data.size();
+        while (begin < end) {
+            const char *nl = static_cast<const char *>(memchr(begin, '\n', end - begin));
+            const char *lineEnd = nl ? nl : end;
+            if (lineEnd - begin >= largeFileLineLength) {
+                return true;
+            }
+            begin = lineEnd + 1;
+        }
+        return false;
     }
 
     void openFileInEditor(const QString &filePath) {
@@ -1409,21 +6286,44 @@ private:
             }
         }
 
-        QFile file(filePath);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        std::unique_ptr<MappedTextSource> source(new MappedTextSource());
+        if (source->open(filePath)) {
             QFileInfo fileInfo(filePath);
             QString ext = fileInfo.suffix().toLower();
-            
+
             CodeEditor *editor = new CodeEditor(ext);
-            editor->setPlainText(QString::fromUtf8(file.readAll()));
+            connect(editor, &CodeEditor::loadProgress, this, [this, fileInfo](qint64 loaded, qint64 total, bool decodingErrors) {
+                QString message = loaded < total
+                    ? QString("Loaded %1 of %2 MB of %3, scroll down for more")
+                          .arg(loaded / (1024.0 * 1024.0), 0, 'f', 1).arg(total / (1024.0 * 1024.0), 0, 'f', 1).arg(fileInfo.fileName())
+                    : "Loaded " + fileInfo.fileName();
+                if (decodingErrors) {
+                    message += " (invalid UTF-8 replaced)";
+                }
+                statusBar()->showMessage(message, loaded < total ? 0 : 3000);
+            });
+
+            const bool large = isLargeFile(source->bytes());
+            editor->setLargeFileMode(large);
+            if (large) {
+                editor->setPagedSource(source.release());
+            } else {
+                editor->setContent(source->readAll());
+            }
             editor->applyTheme(isDarkTheme);
-            file.close();
+            editor->setLineNumbersVisible(showLineNumbers);
 
             int index = tabWidget->addTab(editor, fileInfo.fileName());
             tabWidget->setTabToolTip(index, filePath);
             tabWidget->setCurrentIndex(index);
             
             connect(editor, &CodeEditor::requestImportPanel, this, &WebIDE::updateImportPanel);
+            connect(editor, &QPlainTextEdit::modificationChanged, this, [this, editor, fileInfo](bool modified) {
+                int tab = tabWidget->indexOf(editor);
+                if (tab >= 0) {
+                    tabWidget->setTabText(tab, modified ? fileInfo.fileName() + " *" : fileInfo.fileName());
+                }
+            });
             updateImportPanel();
         }
     }
@@ -1516,8 +6416,7 @@ private:
                 QTextCursor cursor = editor->textCursor();
                 
                 // Try to insert in <head> section
-                QString content = editor->toPlainText();
-                int headPos = content.indexOf("</head>");
+                int headPos = editor->snapshot().indexOf("</head>");
                 
                 if (headPos != -1) {
                     cursor.setPosition(headPos);
@@ -1533,40 +6432,383 @@ private:
         }
     }
 
+    void queueSave(const QString &filePath, CodeEditor *editor, bool skipUnchanged) {
+        savesInFlight.insert(filePath);
+        saveSerials.insert(filePath, editor->editSerial());
+        saveQueue->save(filePath, editor->snapshot(), skipUnchanged ? editor->savedContentHash() : QByteArray());
+        statusBar()->showMessage(QString("Saving %1...").arg(QFileInfo(filePath).fileName()));
+    }
+
+    CodeEditor *editorForPath(const QString &path) const {
+        for (int i = 0; i < tabWidget->count(); ++i) {
+            if (tabWidget->tabToolTip(i) == path) {
+                return qobject_cast<CodeEditor*>(tabWidget->widget(i));
+            }
+        }
+        return nullptr;
+    }
+
     void setupServer() {
-        server = new QTcpServer(this);
-        connect(server, &QTcpServer::newConnection, this, &WebIDE::handleNewConnection);
+        server = new PreviewServer(this);
+        server->setCacheControlRules(cacheControlRules);
+        server->setLiveReloadEnabled(liveReload);
+        server->setSpaFallbackEnabled(spaFallback);
+        server->setExcludePatterns(excludePatterns);
+        // Both watchers see the same .gitignore change, and so do our own
+        // saves; each folder is reloaded once per burst
+        ignoreRulesTimer = new QTimer(this);
+        ignoreRulesTimer->setSingleShot(true);
+        ignoreRulesTimer->setInterval(300);
+        connect(ignoreRulesTimer, &QTimer::timeout, this, &WebIDE::reloadIgnoreRules);
+        connect(server, &PreviewServer::ignoreFileChanged, this, &WebIDE::ignoreFileChanged);
+        connect(treeWatcher, &TreeWatcher::ignoreFileChanged, this, &WebIDE::ignoreFileChanged);
+
+        cacheStatsLabel = new QLabel();
+        cacheStatsLabel->hide();
+        statusBar()->addPermanentWidget(cacheStatsLabel);
+        cacheStatsTimer = new QTimer(this);
+        cacheStatsTimer->setInterval(1000);
+        connect(cacheStatsTimer, &QTimer::timeout, this, &WebIDE::updateCacheStats);
     }
 
     void loadSettings() {
         QSettings settings("WebIDE", "Settings");
         serverPort = settings.value("serverPort", 8080).toInt();
         isDarkTheme = settings.value("isDarkTheme", true).toBool();
+        largeFileSizeMB = settings.value("largeFileSizeMB", 5).toInt();
+        largeFileLineLength = settings.value("largeFileLineLength", 5000).toInt();
+        showLineNumbers = settings.value("showLineNumbers", true).toBool();
+        cacheControlRules = settings.value("cacheControlRules", QStringList{"* = no-cache"}).toStringList();
+        liveReload = settings.value("liveReload", true).toBool();
+        spaFallback = settings.value("spaFallback", false).toBool();
+        excludePatterns = settings.value("excludePatterns", QStringList{"node_modules", "dist", "vendor"}).toStringList();
         portSpinBox->setValue(serverPort);
+        updateEditorModeLabel();
     }
 
     void saveSettings() {
         QSettings settings("WebIDE", "Settings");
         settings.setValue("serverPort", portSpinBox->value());
         settings.setValue("isDarkTheme", isDarkTheme);
+        settings.setValue("largeFileSizeMB", largeFileSizeMB);
+        settings.setValue("largeFileLineLength", largeFileLineLength);
+        settings.setValue("showLineNumbers", showLineNumbers);
+        settings.setValue("cacheControlRules", cacheControlRules);
+        settings.setValue("liveReload", liveReload);
+        settings.setValue("spaFallback", spaFallback);
+        settings.setValue("excludePatterns", excludePatterns);
     }
 
     QTabWidget *leftPanel;
-    QTreeWidget *fileTree;
+    QTreeView *fileTree;
+    FileTreeModel *fileModel;
     QTabWidget *tabWidget;
     QPushButton *serverBtn;
     QSpinBox *portSpinBox;
     QLabel *serverStatusLabel;
-    QTcpServer *server;
+    PreviewServer *server;
+    QLabel *cacheStatsLabel;
+    QTimer *cacheStatsTimer;
+    DirectoryCrawler *crawler;
+    TreeWatcher *treeWatcher;
+    QLabel *scanLabel;
+    QProgressBar *scanProgress;
+    QPushButton *scanCancelButton;
+    QTimer *scanDelayTimer;
+    QTimer *ignoreRulesTimer;
+    QSet<QString> changedIgnoreFolders;
+    SaveQueue *saveQueue;
+    QSet<QString> savesInFlight;
+    QHash<QString, quint64> saveSerials;
+    QStringList saveErrors;
+    int savesDone = 0;
+    int savesSkipped = 0;
     QString currentFolder;
     int serverPort;
     bool isDarkTheme;
+    int largeFileSizeMB;
+    int largeFileLineLength;
+    bool showLineNumbers;
+    QStringList cacheControlRules;
+    bool liveReload = true;
+    bool spaFallback = false;
+    QStringList excludePatterns;
+    QLabel *editorModeLabel;
     QWidget *importPanel;
     QVBoxLayout *importLayout;
 };
 
+// Loads, scrolls and types into an editor widget and prints the timings
+template <typename Editor>
+static void benchmarkEditor(QTextStream &out, const QString &name, Editor *editor, const std::function<void()> &load) {
+    const int scrollSteps = 200;
+    const int keystrokes = 200;
+
+    editor->resize(1000, 800);
+    editor->show();
+
+    QElapsedTimer timer;
+    timer.start();
+    load();
+    QApplication::processEvents();
+    const qint64 loadMs = timer.elapsed();
+
+    QScrollBar *bar = editor->verticalScrollBar();
+    timer.restart();
+    for (int i = 0; i < scrollSteps; ++i) {
+        bar->setValue(bar->maximum() * i / scrollSteps);
+        editor->viewport()->repaint();
+    }
+    const double scrollMs = double(timer.elapsed()) / scrollSteps;
+
+    QTextCursor cursor = editor->textCursor();
+    cursor.setPosition(editor->document()->characterCount() / 2);
+    editor->setTextCursor(cursor);
+    editor->ensureCursorVisible();
+    timer.restart();
+    for (int i = 0; i < keystrokes; ++i) {
+        editor->insertPlainText(i % 2 ? QStringLiteral(" ") : QStringLiteral("a"));
+        editor->viewport()->repaint();
+    }
+    const double typeMs = double(timer.elapsed()) / keystrokes;
+
+    out << QString("%1: load %2 ms, scroll %3 ms/frame, typing %4 ms/keystroke")
+               .arg(name, -28).arg(loadMs).arg(scrollMs, 0, 'f', 2).arg(typeMs, 0, 'f', 2) << Qt::endl;
+    editor->hide();
+}
+
+// Compares the QTextEdit the editor used to be built on against CodeEditor
+// on a 50k-line document. Run with --benchmark-editor.
+static int runEditorBenchmark() {
+    const QStringList sample = {
+        "<div class=\"row\" id=\"item\">",
+        "    <script>",
+        "        function update(value) { return value * 42; } // recompute",
+        "        const items = document.querySelectorAll('.row');",
+        "    </script>",
+        "    <p>Lorem ipsum dolor sit amet, consectetur adipiscing elit.</p>",
+        "</div>"
+    };
+    QString text;
+    for (int i = 0; i < 50000; ++i) {
+        text += sample[i % sample.size()];
+        text += QLatin1Char('\n');
+    }
+
+    QTextStream out(stdout);
+    out << "Editor benchmark, 50000 lines, " << text.size() << " chars (frame budget 16.7 ms)" << Qt::endl;
+
+    QTextEdit legacy;
+    new CodeHighlighter(legacy.document(), CodeLexer::Html);
+    benchmarkEditor(out, "QTextEdit + CodeHighlighter", &legacy, [&]() { legacy.setPlainText(text); });
+
+    CodeEditor editor("html");
+    benchmarkEditor(out, "CodeEditor", &editor, [&]() { editor.setContent(text); });
+    return 0;
+}
+
+struct ServerBenchmarkResult {
+    QVector<qint64> latencies;
+    qint64 bytes = 0;
+    int failures = 0;
+};
+
+// Reads one response off a blocking socket and returns its body size, or -1
+// on a timeout or a non-2xx status
+static qint64 readBenchmarkResponse(QTcpSocket &socket) {
+    QByteArray buffer;
+    qsizetype end;
+    while ((end = buffer.indexOf("\r\n\r\n")) < 0) {
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(10000)) return -1;
+        buffer += socket.readAll();
+    }
+    if (!buffer.startsWith("HTTP/1.1 2")) return -1;
+
+    qint64 length = 0;
+    for (const QByteArray &line : buffer.left(end).split('\n')) {
+        if (line.toLower().startsWith("content-length:")) {
+            length = line.mid(15).trimmed().toLongLong();
+        }
+    }
+    qint64 remaining = length - (buffer.size() - end - 4);
+    while (remaining > 0) {
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(10000)) return -1;
+        remaining -= socket.skip(remaining);
+    }
+    return length;
+}
+
+// One benchmark client: requests paths in turn on a blocking socket, over a
+// single connection when keepAlive is set or a fresh one per request otherwise
+static ServerBenchmarkResult runBenchmarkClient(quint16 port, const QStringList &paths, bool keepAlive) {
+    ServerBenchmarkResult result;
+    QTcpSocket socket;
+    QElapsedTimer timer;
+    for (const QString &path : paths) {
+        timer.start();
+        if (socket.state() != QAbstractSocket::ConnectedState) {
+            socket.abort();
+            socket.connectToHost(QHostAddress::LocalHost, port);
+            if (!socket.waitForConnected(5000)) {
+                ++result.failures;
+                continue;
+            }
+        }
+        socket.write("GET " + path.toUtf8() + " HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: gzip\r\n"
+                     + (keepAlive ? "" : "Connection: close\r\n") + "\r\n");
+        const qint64 body = readBenchmarkResponse(socket);
+        if (body < 0) {
+            ++result.failures;
+            socket.abort();
+            continue;
+        }
+        result.bytes += body;
+        result.latencies.append(timer.nsecsElapsed());
+        if (!keepAlive) {
+            socket.abort();
+        }
+    }
+    return result;
+}
+
+// Current and peak resident memory in MB, or -1 where /proc is unavailable
+static QPair<double, double> residentMemoryMB() {
+    QPair<double, double> memory(-1, -1);
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) return memory;
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() < 2) continue;
+        if (fields[0] == "VmRSS:") memory.first = fields[1].toDouble() / 1024;
+        if (fields[0] == "VmHWM:") memory.second = fields[1].toDouble() / 1024;
+    }
+    return memory;
+}
+
+// Runs one client thread per path list against the server while the calling
+// thread keeps accepting connections, then prints throughput and latency
+static void runServerScenario(QTextStream &out, const QString &name, quint16 port,
+                              const QVector<QStringList> &clients, bool keepAlive) {
+    std::vector<ServerBenchmarkResult> results(clients.size());
+    QVector<QThread*> threads;
+    QEventLoop loop;
+    int running = clients.size();
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < clients.size(); ++i) {
+        QThread *thread = QThread::create([&results, &clients, i, port, keepAlive]() {
+            results[size_t(i)] = runBenchmarkClient(port, clients[i], keepAlive);
+        });
+        QObject::connect(thread, &QThread::finished, &loop, [&running, &loop]() {
+            if (--running == 0) loop.quit();
+        });
+        threads.append(thread);
+        thread->start();
+    }
+    loop.exec();
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    qDeleteAll(threads);
+
+    QVector<qint64> latencies;
+    qint64 bytes = 0;
+    int failures = 0;
+    for (const ServerBenchmarkResult &result : results) {
+        latencies += result.latencies;
+        bytes += result.bytes;
+        failures += result.failures;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentileMs = [&latencies](double fraction) {
+        return latencies.isEmpty() ? 0.0 : latencies[qMin<qsizetype>(qsizetype(latencies.size() * fraction), latencies.size() - 1)] / 1e6;
+    };
+    const QPair<double, double> memory = residentMemoryMB();
+
+    out << QString("%1: %2 req/s, p50 %3 ms, p99 %4 ms, %5 MB/s, %6 failed, RSS %7 MB (peak %8 MB)")
+               .arg(name, -28)
+               .arg(latencies.size() / seconds, 0, 'f', 0)
+               .arg(percentileMs(0.50), 0, 'f', 2)
+               .arg(percentileMs(0.99), 0, 'f', 2)
+               .arg(bytes / seconds / (1024 * 1024), 0, 'f', 1)
+               .arg(failures)
+               .arg(memory.first, 0, 'f', 1)
+               .arg(memory.second, 0, 'f', 1) << Qt::endl;
+}
+
+// Starts a PreviewServer on a synthetic project and drives it with local
+// clients through small-file, keep-alive, cold-cache and large-file
+// scenarios. Run with --benchmark-server.
+static int runServerBenchmark() {
+    const int smallFiles = 1600;
+    const int hotFiles = 200;
+    const int clientCount = 8;
+    const qint64 largeFileMB = 64;
+
+    QTemporaryDir project;
+    QDir root(project.path());
+    root.mkpath("assets");
+    root.mkpath("media");
+    const QByteArray line = "export function update(value) { return document.querySelectorAll('.row').length * value; }\n";
+    for (int i = 0; i < smallFiles; ++i) {
+        QFile file(root.filePath(QString("assets/app%1.js").arg(i)));
+        if (!file.open(QIODevice::WriteOnly)) return 1;
+        file.write(line.repeated(40));
+    }
+    QFile large(root.filePath("media/video.bin"));
+    if (!large.open(QIODevice::WriteOnly)) return 1;
+    const QByteArray block(1024 * 1024, 'x');
+    for (qint64 i = 0; i < largeFileMB; ++i) {
+        large.write(block);
+    }
+    large.close();
+
+    PreviewServer server;
+    server.setRootPath(project.path());
+    if (!server.listen(QHostAddress::LocalHost, 0)) return 1;
+    const quint16 port = server.serverPort();
+
+    QTextStream out(stdout);
+    out << "Server benchmark, " << clientCount << " clients, " << smallFiles << " x "
+        << line.size() * 40 << " byte files, " << largeFileMB << " MB large file" << Qt::endl;
+
+    auto smallPaths = [](int client, int count, int fileCount) {
+        QStringList paths;
+        for (int i = 0; i < count; ++i) {
+            paths << QString("/assets/app%1.js").arg((client * count + i) % fileCount);
+        }
+        return paths;
+    };
+    QVector<QStringList> clients;
+
+    server.cache()->clear();
+    for (int i = 0; i < clientCount; ++i) clients << smallPaths(i, smallFiles / clientCount, smallFiles);
+    runServerScenario(out, "Cold cache (keep-alive)", port, clients, true);
+
+    clients.clear();
+    for (int i = 0; i < clientCount; ++i) clients << smallPaths(i, 250, hotFiles);
+    runServerScenario(out, "Small files (new connection)", port, clients, false);
+
+    clients.clear();
+    for (int i = 0; i < clientCount; ++i) clients << smallPaths(i, 2000, hotFiles);
+    runServerScenario(out, "Small files (keep-alive)", port, clients, true);
+
+    clients.clear();
+    for (int i = 0; i < clientCount / 2; ++i) clients << QStringList{"/media/video.bin", "/media/video.bin"};
+    runServerScenario(out, "Large file", port, clients, true);
+
+    server.close();
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
+
+    if (app.arguments().contains("--benchmark-editor")) {
+        return runEditorBenchmark();
+    }
+    if (app.arguments().contains("--benchmark-server")) {
+        return runServerBenchmark();
+    }
     
     WebIDE ide;
     ide.show();